@@ -0,0 +1,534 @@
+// Throughput, per-operation latency and allocations of every queue of the
+// repository, as CSV. Every engine runs 1:1, 1:N, N:1 and N:N producer to
+// consumer matrices with 8, 64 and 256 byte items. Latencies are sampled
+// every LATENCY_SAMPLE_PERIOD operations and include the clock reads; a
+// blocking dequeue counts the time spent waiting for an item. For
+// thread_pool the enqueue is submit() and the dequeue latency is the time
+// from submit() to the start of the task.
+// usage: queue_benchmark [items per run] [max threads] [engine|all] [pin]
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "../task2/problem2/thread_safe_queue.h"
+#include "../task2/thread_pool/thread_pool.h"
+#include "../task6/spsc_ring_buffer/spsc_ring_buffer.h"
+#include "../task7/lock_free_queue/lock_free_queue.h"
+
+const std::size_t DEFAULT_ITEMS = 200000;
+const std::size_t BOUNDED_CAPACITY = 1024; // of the bounded queue and of every spsc ring
+const std::size_t LATENCY_SAMPLE_PERIOD = 16;
+const std::uint64_t POISON_PILL = UINT64_MAX;
+
+using clock_type = std::chrono::steady_clock;
+
+// Allocations of the whole process, every thread counts on its own line
+const std::size_t ALLOCATION_COUNTERS = 64;
+
+struct alignas(64) allocation_counter {
+    std::atomic<std::size_t> count{0};
+};
+
+allocation_counter allocation_counters[ALLOCATION_COUNTERS];
+std::atomic<std::size_t> next_allocation_counter(0);
+thread_local std::size_t allocation_counter_index = ALLOCATION_COUNTERS;
+
+std::size_t allocations() {
+    std::size_t total = 0;
+    for (auto& counter : allocation_counters) {
+        total += counter.count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void count_allocation() {
+    if (allocation_counter_index == ALLOCATION_COUNTERS) {
+        allocation_counter_index = next_allocation_counter.fetch_add(
+                1, std::memory_order_relaxed) % ALLOCATION_COUNTERS;
+    }
+    allocation_counters[allocation_counter_index].count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    count_allocation();
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+// alignas(64) types: the spsc rings, padded nodes and counters
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    count_allocation();
+    std::size_t align = static_cast<std::size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment
+    void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+// every allocation above comes from malloc or aligned_alloc, both freed by
+// free; GCC sees only new paired with free and warns once deletes inline
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    operator delete(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    operator delete(pointer);
+}
+
+template <std::size_t Size>
+struct payload {
+    std::uint64_t sequence;
+    std::array<std::uint8_t, Size - sizeof(std::uint64_t)> data;
+};
+
+template <class Item>
+Item poison_pill() {
+    Item item{};
+    item.sequence = POISON_PILL;
+    return item;
+}
+
+// cpus this process may run on, thread i is pinned to the i-th one
+std::vector<int> allowed_cpus() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void pin_to_cpu(const std::vector<int>& cpus, std::size_t index) {
+    if (cpus.empty()) {
+        return;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[index % cpus.size()], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Engines: push(producer, item) returns once the item is in, pop(consumer,
+// item) returns false when the consumer got its poison pill, close() is
+// called after every producer has finished and hands out the pills.
+
+// thread_safe_queue and bounded_thread_safe_queue: consumers sleep on the queue
+template <class Queue, class Item>
+class blocking_engine {
+public:
+    template <class... Args>
+    explicit blocking_engine(std::size_t num_consumers, Args... args)
+            : queue_(args...),
+              num_consumers_(num_consumers) {
+    }
+    void push(std::size_t, const Item& item) { queue_.enqueue(item); }
+    bool pop(std::size_t, Item& item) {
+        queue_.pop(item);
+        return item.sequence != POISON_PILL;
+    }
+    void close() {
+        for (std::size_t i = 0; i < num_consumers_; ++i) {
+            queue_.enqueue(poison_pill<Item>());
+        }
+    }
+
+private:
+    Queue queue_;
+    std::size_t num_consumers_;
+};
+
+// A ring for every producer and consumer pair: producers deal their items
+// round-robin and skip full rings, consumers poll the rings of all producers
+template <class Item>
+class spsc_engine {
+public:
+    spsc_engine(std::size_t num_producers, std::size_t num_consumers, std::size_t capacity)
+            : num_producers_(num_producers),
+              num_consumers_(num_consumers),
+              producers_(num_producers),
+              consumers_(num_consumers) {
+        for (std::size_t i = 0; i < num_producers * num_consumers; ++i) {
+            rings_.emplace_back(new spsc_ring_buffer<Item>(capacity));
+        }
+    }
+    void push(std::size_t producer, const Item& item) {
+        std::size_t& next = producers_[producer].next;
+        for (std::size_t failures = 1; !ring_(producer, next).enqueue(item); ++failures) {
+            next = next + 1 == num_consumers_ ? 0 : next + 1;
+            if (failures % num_consumers_ == 0) {
+                std::this_thread::yield();
+            }
+        }
+        next = next + 1 == num_consumers_ ? 0 : next + 1;
+    }
+    bool pop(std::size_t consumer, Item& item) {
+        cursor_& cursor = consumers_[consumer];
+        for (std::size_t misses = 1; ; ++misses) {
+            bool found = ring_(cursor.next, consumer).dequeue(item);
+            cursor.next = cursor.next + 1 == num_producers_ ? 0 : cursor.next + 1;
+            if (found && item.sequence != POISON_PILL) {
+                return true;
+            }
+            // one pill per producer ring
+            if (found && ++cursor.pills == num_producers_) {
+                return false;
+            }
+            if (misses % num_producers_ == 0) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    // the producers have been joined, this thread may take their place
+    void close() {
+        for (auto& ring : rings_) {
+            while (!ring->enqueue(poison_pill<Item>())) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    struct alignas(64) cursor_ {
+        std::size_t next = 0;
+        std::size_t pills = 0;
+    };
+
+    std::size_t num_producers_;
+    std::size_t num_consumers_;
+    std::vector<std::unique_ptr<spsc_ring_buffer<Item>>> rings_;
+    std::vector<cursor_> producers_;
+    std::vector<cursor_> consumers_;
+
+    spsc_ring_buffer<Item>& ring_(std::size_t producer, std::size_t consumer) {
+        return *rings_[producer * num_consumers_ + consumer];
+    }
+};
+
+// lock_free_queue never blocks, consumers yield while it is empty
+template <class Item>
+class lock_free_engine {
+public:
+    explicit lock_free_engine(std::size_t num_consumers) : num_consumers_(num_consumers) {}
+    void push(std::size_t, const Item& item) { queue_.enqueue(item); }
+    bool pop(std::size_t, Item& item) {
+        while (!queue_.dequeue(item)) {
+            std::this_thread::yield();
+        }
+        return item.sequence != POISON_PILL;
+    }
+    void close() {
+        for (std::size_t i = 0; i < num_consumers_; ++i) {
+            queue_.enqueue(poison_pill<Item>());
+        }
+    }
+
+private:
+    lock_free_queue<Item> queue_;
+    std::size_t num_consumers_;
+};
+
+struct run_config {
+    std::string engine;
+    std::string mode;
+    std::size_t producers;
+    std::size_t consumers;
+    std::size_t payload_bytes;
+    std::size_t items; // per producer
+    const std::vector<int>* pinned_cpus; // nullptr when threads float
+};
+
+struct alignas(64) thread_statistics {
+    std::vector<std::uint64_t> latencies_ns;
+    std::uint64_t checksum = 0;
+};
+
+double percentile(std::vector<std::uint64_t>& samples, double share) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(share * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return static_cast<double>(samples[index]);
+}
+
+std::vector<std::uint64_t> merged_latencies(const std::vector<thread_statistics>& threads) {
+    std::vector<std::uint64_t> merged;
+    for (auto& thread : threads) {
+        merged.insert(merged.end(), thread.latencies_ns.begin(), thread.latencies_ns.end());
+    }
+    return merged;
+}
+
+std::uint64_t elapsed_ns(clock_type::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+}
+
+void wait_for_start(const std::atomic<bool>& started) {
+    while (!started.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+// the sequences 0 .. n - 1 were sent once each
+bool report(const run_config& config, double seconds, std::size_t allocated,
+            std::uint64_t checksum, std::vector<std::uint64_t> enqueue_ns,
+            std::vector<std::uint64_t> dequeue_ns) {
+    std::uint64_t total = config.items * config.producers;
+    if (checksum != total * (total - 1) / 2) {
+        std::cerr << config.engine << ": lost or duplicated items" << std::endl;
+        return false;
+    }
+    std::cout << config.engine << ',' << config.mode << ',' << config.producers << ','
+              << config.consumers << ',' << config.payload_bytes << ','
+              << total / seconds / 1e6 << ','
+              << percentile(enqueue_ns, 0.5) << ',' << percentile(enqueue_ns, 0.99) << ','
+              << percentile(enqueue_ns, 0.999) << ','
+              << percentile(dequeue_ns, 0.5) << ',' << percentile(dequeue_ns, 0.99) << ','
+              << percentile(dequeue_ns, 0.999) << ','
+              << static_cast<double>(allocated) / total << std::endl;
+    return true;
+}
+
+template <class Item, class Engine>
+bool run(const run_config& config, Engine& engine) {
+    std::vector<thread_statistics> producers(config.producers);
+    std::vector<thread_statistics> consumers(config.consumers);
+    std::size_t expected_samples = config.items * config.producers / LATENCY_SAMPLE_PERIOD + 2;
+    for (auto& producer : producers) {
+        producer.latencies_ns.reserve(config.items / LATENCY_SAMPLE_PERIOD + 1);
+    }
+    for (auto& consumer : consumers) {
+        consumer.latencies_ns.reserve(expected_samples);
+    }
+
+    std::atomic<bool> started(false);
+    std::vector<std::thread> producer_threads;
+    std::vector<std::thread> consumer_threads;
+    for (std::size_t i = 0; i < config.producers; ++i) {
+        producer_threads.emplace_back([&config, &engine, &started, &producers, i] {
+            if (config.pinned_cpus) {
+                pin_to_cpu(*config.pinned_cpus, i);
+            }
+            thread_statistics& statistics = producers[i];
+            Item item{};
+            wait_for_start(started);
+            for (std::size_t k = 0; k < config.items; ++k) {
+                item.sequence = i * config.items + k;
+                if (k % LATENCY_SAMPLE_PERIOD == 0) {
+                    auto start = clock_type::now();
+                    engine.push(i, item);
+                    statistics.latencies_ns.push_back(elapsed_ns(start));
+                } else {
+                    engine.push(i, item);
+                }
+            }
+        });
+    }
+    for (std::size_t i = 0; i < config.consumers; ++i) {
+        consumer_threads.emplace_back([&config, &engine, &started, &consumers, i] {
+            if (config.pinned_cpus) {
+                pin_to_cpu(*config.pinned_cpus, config.producers + i);
+            }
+            thread_statistics& statistics = consumers[i];
+            Item item;
+            wait_for_start(started);
+            for (std::size_t k = 0; ; ++k) {
+                bool popped;
+                if (k % LATENCY_SAMPLE_PERIOD == 0 &&
+                        statistics.latencies_ns.size() < statistics.latencies_ns.capacity()) {
+                    auto start = clock_type::now();
+                    popped = engine.pop(i, item);
+                    statistics.latencies_ns.push_back(elapsed_ns(start));
+                } else {
+                    popped = engine.pop(i, item);
+                }
+                if (!popped) {
+                    break;
+                }
+                statistics.checksum += item.sequence;
+            }
+        });
+    }
+
+    std::size_t allocated = allocations();
+    auto start = clock_type::now();
+    started.store(true, std::memory_order_release);
+    for (auto& thread : producer_threads) {
+        thread.join();
+    }
+    engine.close();
+    for (auto& thread : consumer_threads) {
+        thread.join();
+    }
+    double seconds = elapsed_ns(start) / 1e9;
+    allocated = allocations() - allocated;
+
+    std::uint64_t checksum = 0;
+    for (auto& consumer : consumers) {
+        checksum += consumer.checksum;
+    }
+    return report(config, seconds, allocated, checksum,
+                  merged_latencies(producers), merged_latencies(consumers));
+}
+
+// The pool owns its workers and runs them unpinned, producers are pinned
+template <class Item>
+bool run_thread_pool(const run_config& config) {
+    thread_pool<int> pool(config.consumers);
+    std::vector<thread_statistics> producers(config.producers);
+    for (auto& producer : producers) {
+        producer.latencies_ns.reserve(config.items / LATENCY_SAMPLE_PERIOD + 1);
+    }
+    // a sampled task writes its own slot
+    std::vector<std::uint64_t> sojourn_ns(
+            (config.items * config.producers + LATENCY_SAMPLE_PERIOD - 1) / LATENCY_SAMPLE_PERIOD);
+    std::atomic<std::uint64_t> checksum(0);
+
+    std::atomic<bool> started(false);
+    std::vector<std::thread> producer_threads;
+    for (std::size_t i = 0; i < config.producers; ++i) {
+        producer_threads.emplace_back(
+                [&config, &pool, &started, &producers, &sojourn_ns, &checksum, i] {
+            if (config.pinned_cpus) {
+                pin_to_cpu(*config.pinned_cpus, i);
+            }
+            thread_statistics& statistics = producers[i];
+            Item item{};
+            wait_for_start(started);
+            for (std::size_t k = 0; k < config.items; ++k) {
+                item.sequence = i * config.items + k;
+                auto submitted = clock_type::now();
+                pool.submit([item, submitted, &sojourn_ns, &checksum] {
+                    if (item.sequence % LATENCY_SAMPLE_PERIOD == 0) {
+                        sojourn_ns[item.sequence / LATENCY_SAMPLE_PERIOD] = elapsed_ns(submitted);
+                    }
+                    checksum.fetch_add(item.sequence, std::memory_order_relaxed);
+                    return 0;
+                });
+                if (k % LATENCY_SAMPLE_PERIOD == 0) {
+                    statistics.latencies_ns.push_back(elapsed_ns(submitted));
+                }
+            }
+        });
+    }
+
+    std::size_t allocated = allocations();
+    auto start = clock_type::now();
+    started.store(true, std::memory_order_release);
+    for (auto& thread : producer_threads) {
+        thread.join();
+    }
+    // poison pills queue up behind the last task
+    pool.shutdown();
+    double seconds = elapsed_ns(start) / 1e9;
+    allocated = allocations() - allocated;
+
+    return report(config, seconds, allocated, checksum.load(),
+                  merged_latencies(producers), sojourn_ns);
+}
+
+template <class Item>
+bool run_engine(run_config config) {
+    std::size_t p = config.producers;
+    std::size_t c = config.consumers;
+    if (config.engine == "unbounded") {
+        blocking_engine<thread_safe_queue<Item>, Item> engine(c);
+        return run<Item>(config, engine);
+    }
+    if (config.engine == "bounded") {
+        blocking_engine<bounded_thread_safe_queue<Item>, Item> engine(c, BOUNDED_CAPACITY);
+        return run<Item>(config, engine);
+    }
+    if (config.engine == "spsc") {
+        spsc_engine<Item> engine(p, c, BOUNDED_CAPACITY);
+        return run<Item>(config, engine);
+    }
+    if (config.engine == "lock_free") {
+        lock_free_engine<Item> engine(c);
+        return run<Item>(config, engine);
+    }
+    return run_thread_pool<Item>(config);
+}
+
+bool run_payloads(run_config config) {
+    config.payload_bytes = 8;
+    bool ok = run_engine<payload<8>>(config);
+    config.payload_bytes = 64;
+    ok = run_engine<payload<64>>(config) && ok;
+    config.payload_bytes = 256;
+    return run_engine<payload<256>>(config) && ok;
+}
+
+int main(int argc, char** argv) {
+    std::size_t items = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_ITEMS;
+    std::size_t max_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10)
+                                       : std::thread::hardware_concurrency();
+    std::string selected = argc > 3 ? argv[3] : "all";
+    bool pin = argc > 4 && std::string(argv[4]) == "pin";
+
+    const std::string ENGINES[] = {"unbounded", "bounded", "spsc", "lock_free", "thread_pool"};
+    if (selected != "all" && std::find(std::begin(ENGINES), std::end(ENGINES), selected)
+            == std::end(ENGINES)) {
+        std::cerr << "unknown engine " << selected << std::endl;
+        return 1;
+    }
+    // N threads on each side of the N:N run
+    std::size_t n = std::max<std::size_t>(max_threads / 2, 2);
+    const std::size_t MATRIX[][2] = {{1, 1}, {1, n}, {n, 1}, {n, n}};
+    std::vector<int> cpus = allowed_cpus();
+
+    std::cout << "engine,mode,producers,consumers,payload_bytes,mops,"
+                 "enqueue_p50_ns,enqueue_p99_ns,enqueue_p999_ns,"
+                 "dequeue_p50_ns,dequeue_p99_ns,dequeue_p999_ns,allocs_per_op\n";
+    bool ok = true;
+    for (const std::string& engine : ENGINES) {
+        if (selected != "all" && selected != engine) {
+            continue;
+        }
+        for (auto& threads : MATRIX) {
+            run_config config;
+            config.engine = engine;
+            config.mode = engine == "bounded" || engine == "spsc" ? "bounded" : "unbounded";
+            config.producers = threads[0];
+            config.consumers = threads[1];
+            config.items = std::max<std::size_t>(items / threads[0], 1);
+            config.pinned_cpus = pin ? &cpus : nullptr;
+            ok = run_payloads(config) && ok;
+        }
+    }
+    return ok ? 0 : 1;
+}
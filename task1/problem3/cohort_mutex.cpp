@@ -0,0 +1,114 @@
+#include "cohort_mutex.h"
+#include <algorithm>
+#include <dirent.h>
+#include <fstream>
+#include <map>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+
+numa_topology::numa_topology(const std::string& root) : num_nodes_(1) {
+    DIR* directory = opendir(root.c_str());
+    if (directory == nullptr) {
+        return;
+    }
+    std::map<std::size_t, std::string> cpulists; // sorted by node id
+    while (dirent* entry = readdir(directory)) {
+        std::string name = entry->d_name;
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+            std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+            std::ifstream file(root + "/" + name + "/cpulist");
+            std::string cpulist;
+            if (std::getline(file, cpulist)) {
+                cpulists[std::stoul(name.substr(4))] = cpulist;
+            }
+        }
+    }
+    closedir(directory);
+
+    std::size_t node = 0;
+    for (const auto& cpulist : cpulists) {
+        // comma separated cpus and ranges: 0-3,8-11
+        std::istringstream ranges(cpulist.second);
+        std::string range;
+        bool has_cpus = false;
+        while (std::getline(ranges, range, ',')) {
+            if (range.empty()) {
+                continue;
+            }
+            std::size_t dash = range.find('-');
+            std::size_t first = std::stoul(range.substr(0, dash));
+            std::size_t last = dash == std::string::npos ? first : std::stoul(range.substr(dash + 1));
+            if (node_of_cpu_.size() <= last) {
+                node_of_cpu_.resize(last + 1, 0);
+            }
+            for (std::size_t cpu = first; cpu <= last; ++cpu) {
+                node_of_cpu_[cpu] = node;
+            }
+            has_cpus = true;
+        }
+        // memory-only nodes get no index
+        if (has_cpus) {
+            ++node;
+        }
+    }
+    num_nodes_ = std::max<std::size_t>(node, 1);
+}
+
+numa_topology::numa_topology(std::vector<std::size_t> node_of_cpu)
+        : node_of_cpu_(std::move(node_of_cpu)),
+          num_nodes_(1) {
+    for (std::size_t node : node_of_cpu_) {
+        num_nodes_ = std::max(num_nodes_, node + 1);
+    }
+}
+
+std::size_t numa_topology::node_of_cpu(std::size_t cpu) const {
+    return cpu < node_of_cpu_.size() ? node_of_cpu_[cpu] : 0;
+}
+
+std::size_t numa_topology::current_node() const {
+    if (num_nodes_ == 1) {
+        return 0;
+    }
+    int cpu = sched_getcpu();
+    return cpu < 0 ? 0 : node_of_cpu(cpu);
+}
+
+cohort_mutex::cohort_mutex(std::size_t num_threads, const numa_topology& topology)
+        : topology_(topology),
+          cohorts_(new cohort_[topology.num_nodes()]),
+          threads_(new thread_[num_threads]),
+          global_(topology.num_nodes()) {
+}
+
+void cohort_mutex::lock(std::size_t thread_index) {
+    std::size_t node = topology_.current_node();
+    threads_[thread_index].node = node;
+    cohort_& cohort = cohorts_[node];
+    std::size_t ticket = cohort.next_ticket.fetch_add(1, std::memory_order_relaxed);
+    for (std::size_t spins = 0; cohort.now_serving.load(std::memory_order_acquire) != ticket; ) {
+        spin_wait(spins);
+    }
+    // one thread per node at a time competes for the global lock
+    if (!cohort.owns_global) {
+        global_.lock(node);
+        cohort.owns_global = true;
+    }
+}
+
+void cohort_mutex::unlock(std::size_t thread_index) {
+    std::size_t node = threads_[thread_index].node;
+    cohort_& cohort = cohorts_[node];
+    std::size_t serving = cohort.now_serving.load(std::memory_order_relaxed);
+    bool has_waiters = cohort.next_ticket.load(std::memory_order_relaxed) != serving + 1;
+    if (has_waiters && cohort.handoffs < MAX_COHORT_HANDOFFS) {
+        ++cohort.handoffs;
+    } else {
+        // let the other nodes in
+        cohort.handoffs = 0;
+        cohort.owns_global = false;
+        global_.unlock(node);
+    }
+    cohort.now_serving.store(serving + 1, std::memory_order_release);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "tree_mutex.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+const std::size_t MAX_COHORT_HANDOFFS = 64; // local handoffs before the global lock moves on
+
+// CPU to NUMA node map read from /sys/devices/system/node, node ids are
+// renumbered densely. A machine without that directory is one node.
+class numa_topology {
+public:
+    explicit numa_topology(const std::string& root = "/sys/devices/system/node");
+    // a node for each cpu given by its index, for tests and other layouts
+    explicit numa_topology(std::vector<std::size_t> node_of_cpu);
+
+    std::size_t num_nodes() const noexcept { return num_nodes_; }
+    std::size_t node_of_cpu(std::size_t cpu) const;
+    // node of the cpu the calling thread is running on right now
+    std::size_t current_node() const;
+
+private:
+    std::vector<std::size_t> node_of_cpu_;
+    std::size_t num_nodes_;
+};
+
+// Lock cohorting (Dice, Marathe, Shavit): threads first take a ticket lock
+// of their NUMA node, the winner then takes the global lock, a tree_mutex
+// whose leaves are nodes. On unlock the global lock is passed to the next
+// local waiter, up to MAX_COHORT_HANDOFFS times in a row, so the lock and
+// the data it protects stay in the caches of one socket.
+class cohort_mutex {
+public:
+    explicit cohort_mutex(std::size_t num_threads, const numa_topology& topology = numa_topology());
+    void lock(std::size_t thread_index);
+    void unlock(std::size_t thread_index);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) cohort_ {
+        std::atomic<std::size_t> next_ticket{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> now_serving{0};
+        // written by the holder of the local lock only
+        bool owns_global = false; // inherited from the previous local holder
+        std::size_t handoffs = 0;
+    };
+    struct alignas(CACHE_LINE_SIZE) thread_ {
+        std::size_t node; // the thread may migrate while it holds the lock
+    };
+
+    numa_topology topology_;
+    std::unique_ptr<cohort_[]> cohorts_;
+    std::unique_ptr<thread_[]> threads_;
+    tree_mutex global_; // indexed by node
+};
@@ -0,0 +1,179 @@
+// Throughput, acquire latency and fairness of the locks of this directory
+// against the standard ones and a spinlock, as CSV. Every run sweeps thread
+// counts, critical section and outside work lengths; a unit of work is a
+// few nanoseconds of dependent arithmetic.
+// usage: lock_benchmark [max threads] [milliseconds per run] [lock]
+#include "tree_mutex.h"
+#include "queue_mutex.h"
+#include "cohort_mutex.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const std::size_t DEFAULT_MAX_THREADS = 8;
+const std::size_t DEFAULT_RUN_MS = 200;
+const std::size_t CRITICAL_WORK[] = {0, 100, 1000};
+const std::size_t OUTSIDE_WORK[] = {0, 1000};
+
+using clock_type = std::chrono::steady_clock;
+
+// adapters to the lock(thread_index) interface
+template <class Mutex>
+struct standard_lock {
+    explicit standard_lock(std::size_t) {}
+    void lock(std::size_t) { mutex.lock(); }
+    void unlock(std::size_t) { mutex.unlock(); }
+    Mutex mutex;
+};
+
+// test and test-and-set
+struct spinlock {
+    explicit spinlock(std::size_t) : locked(false) {}
+    void lock(std::size_t) {
+        std::size_t spins = 0;
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            while (locked.load(std::memory_order_relaxed)) {
+                spin_wait(spins);
+            }
+        }
+    }
+    void unlock(std::size_t) { locked.store(false, std::memory_order_release); }
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> locked;
+};
+
+std::uint64_t work(std::size_t units, std::uint64_t seed) {
+    for (std::size_t i = 0; i < units; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return seed;
+}
+
+struct alignas(CACHE_LINE_SIZE) thread_result {
+    std::vector<std::uint32_t> acquire_ns;
+    std::uint64_t max_gap_ns = 0; // longest time without an acquisition
+    std::uint64_t sink = 0;
+};
+
+double percentile(std::vector<std::uint32_t>& samples, double share) {
+    if (samples.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(share * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+template <class Lock>
+void run(const std::string& name, std::size_t num_threads, std::size_t critical_work,
+         std::size_t outside_work, std::chrono::milliseconds duration) {
+    Lock lock(num_threads);
+    std::vector<thread_result> results(num_threads);
+    std::atomic<bool> start(false), stop(false);
+    std::uint64_t shared_state = 0; // touched in the critical section only
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 0; thread < num_threads; ++thread) {
+        threads.emplace_back([&, thread] {
+            thread_result& result = results[thread];
+            result.acquire_ns.reserve(1 << 20);
+            std::uint64_t local = thread;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            auto last = clock_type::now();
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto before = clock_type::now();
+                lock.lock(thread);
+                auto locked = clock_type::now();
+                shared_state = work(critical_work, shared_state + 1);
+                lock.unlock(thread);
+                result.acquire_ns.push_back(static_cast<std::uint32_t>(std::min<std::int64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(locked - before).count(),
+                        std::numeric_limits<std::uint32_t>::max())));
+                result.max_gap_ns = std::max<std::uint64_t>(result.max_gap_ns,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(locked - last).count());
+                last = locked;
+                local = work(outside_work, local);
+            }
+            // the wait from the last acquisition, or from the start for a
+            // thread that never got the lock, up to the stop
+            result.max_gap_ns = std::max<std::uint64_t>(result.max_gap_ns,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            clock_type::now() - last).count());
+            result.sink = local;
+        });
+    }
+    start.store(true);
+    std::this_thread::sleep_for(duration);
+    stop.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<std::uint32_t> acquire_ns;
+    std::size_t total = 0, fewest = std::numeric_limits<std::size_t>::max(), most = 0;
+    std::uint64_t max_gap_ns = 0;
+    double sum_squares = 0;
+    for (auto& result : results) {
+        std::size_t count = result.acquire_ns.size();
+        total += count;
+        fewest = std::min(fewest, count);
+        most = std::max(most, count);
+        sum_squares += static_cast<double>(count) * count;
+        max_gap_ns = std::max(max_gap_ns, result.max_gap_ns);
+        acquire_ns.insert(acquire_ns.end(), result.acquire_ns.begin(), result.acquire_ns.end());
+    }
+    double fair_share = static_cast<double>(total) / num_threads;
+    // Jain's index: 1 when all threads got the same number of acquisitions
+    double jain = sum_squares > 0 ? static_cast<double>(total) * total / (num_threads * sum_squares) : 0;
+    std::cout << name << ',' << num_threads << ',' << critical_work << ',' << outside_work << ','
+              << total / std::chrono::duration<double>(duration).count() / 1e6 << ','
+              << percentile(acquire_ns, 0.5) << ',' << percentile(acquire_ns, 0.99) << ','
+              << percentile(acquire_ns, 0.999) << ','
+              << (fair_share > 0 ? fewest / fair_share : 0) << ','
+              << (fair_share > 0 ? most / fair_share : 0) << ',' << jain << ','
+              << max_gap_ns / 1000 << std::endl;
+}
+
+template <class Lock>
+void sweep(const std::string& name, const std::string& only, std::size_t max_threads,
+           std::chrono::milliseconds duration) {
+    if (!only.empty() && only != name) {
+        return;
+    }
+    for (std::size_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+        for (std::size_t critical_work : CRITICAL_WORK) {
+            for (std::size_t outside_work : OUTSIDE_WORK) {
+                run<Lock>(name, num_threads, critical_work, outside_work, duration);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_MAX_THREADS;
+    std::chrono::milliseconds duration(
+            argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_RUN_MS);
+    std::string only = argc > 3 ? argv[3] : "";
+
+    std::cout << "lock,threads,critical_work,outside_work,mops,acquire_p50_ns,acquire_p99_ns,"
+                 "acquire_p999_ns,min_share,max_share,jain_fairness,max_starvation_us\n";
+    sweep<tree_mutex>("tree_mutex", only, max_threads, duration);
+    sweep<mcs_mutex>("mcs_mutex", only, max_threads, duration);
+    sweep<clh_mutex>("clh_mutex", only, max_threads, duration);
+    sweep<ticket_mutex>("ticket_mutex", only, max_threads, duration);
+    sweep<cohort_mutex>("cohort_mutex", only, max_threads, duration);
+    sweep<spinlock>("spinlock", only, max_threads, duration);
+    sweep<standard_lock<std::mutex>>("std_mutex", only, max_threads, duration);
+    sweep<standard_lock<std::shared_timed_mutex>>("std_shared_timed_mutex", only, max_threads,
+                                                  duration);
+    return 0;
+}
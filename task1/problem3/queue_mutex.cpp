@@ -0,0 +1,132 @@
+#include "queue_mutex.h"
+#include <algorithm>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// spinning on a single core only delays the holder
+std::size_t spin_budget() {
+    static const std::size_t budget =
+            std::thread::hardware_concurrency() > 1 ? SPINS_BEFORE_YIELD : 0;
+    return budget;
+}
+
+} // namespace
+
+void spin_wait(std::size_t& spins) {
+    if (spins < spin_budget()) {
+        ++spins;
+        cpu_relax();
+    } else {
+        std::this_thread::yield(); // the holder may be waiting for this core
+    }
+}
+
+mcs_mutex::mcs_mutex(std::size_t num_threads) : nodes_(new node_[num_threads]), tail_(nullptr) {
+    for (std::size_t i = 0; i < num_threads; ++i) {
+        nodes_[i].next.store(nullptr);
+        nodes_[i].locked.store(false);
+    }
+}
+
+void mcs_mutex::lock(std::size_t thread_index) {
+    node_* node = &nodes_[thread_index];
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->locked.store(true, std::memory_order_relaxed);
+    node_* predecessor = tail_.exchange(node, std::memory_order_acq_rel);
+    if (predecessor == nullptr) {
+        return;
+    }
+    predecessor->next.store(node, std::memory_order_release);
+    for (std::size_t spins = 0; node->locked.load(std::memory_order_acquire); ) {
+        spin_wait(spins);
+    }
+}
+
+void mcs_mutex::unlock(std::size_t thread_index) {
+    node_* node = &nodes_[thread_index];
+    node_* successor = node->next.load(std::memory_order_acquire);
+    if (successor == nullptr) {
+        node_* expected = node;
+        if (tail_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+            return;
+        }
+        // a thread has swapped the tail but not linked itself yet
+        for (std::size_t spins = 0;
+             (successor = node->next.load(std::memory_order_acquire)) == nullptr; ) {
+            spin_wait(spins);
+        }
+    }
+    successor->locked.store(false, std::memory_order_release);
+}
+
+clh_mutex::clh_mutex(std::size_t num_threads)
+        : nodes_(new node_[num_threads + 1]),
+          threads_(new thread_[num_threads]) {
+    for (std::size_t i = 0; i <= num_threads; ++i) {
+        nodes_[i].locked.store(false);
+    }
+    for (std::size_t i = 0; i < num_threads; ++i) {
+        threads_[i].node = &nodes_[i];
+        threads_[i].predecessor = nullptr;
+    }
+    tail_.store(&nodes_[num_threads]);
+}
+
+void clh_mutex::lock(std::size_t thread_index) {
+    thread_& thread = threads_[thread_index];
+    thread.node->locked.store(true, std::memory_order_relaxed);
+    thread.predecessor = tail_.exchange(thread.node, std::memory_order_acq_rel);
+    for (std::size_t spins = 0; thread.predecessor->locked.load(std::memory_order_acquire); ) {
+        spin_wait(spins);
+    }
+}
+
+void clh_mutex::unlock(std::size_t thread_index) {
+    thread_& thread = threads_[thread_index];
+    node_* node = thread.node;
+    // nobody spins on the predecessor any more, it is ours to reuse
+    thread.node = thread.predecessor;
+    node->locked.store(false, std::memory_order_release);
+}
+
+ticket_mutex::ticket_mutex(std::size_t) : next_ticket_(0), now_serving_(0) {
+}
+
+void ticket_mutex::lock(std::size_t) {
+    std::size_t ticket = next_ticket_.fetch_add(1, std::memory_order_relaxed);
+    std::size_t serving = now_serving_.load(std::memory_order_acquire);
+    // a spin budget per thread ahead, a fixed one would cut the backoff
+    // of long queues short and send them to yield
+    std::size_t budget = (ticket - serving) * spin_budget();
+    std::size_t spins = 0;
+    while (serving != ticket) {
+        if (spins >= budget) {
+            std::this_thread::yield();
+        } else {
+            std::size_t pauses = std::min((ticket - serving) * TICKET_BACKOFF, budget - spins);
+            for (std::size_t i = 0; i < pauses; ++i) {
+                cpu_relax();
+            }
+            spins += pauses;
+        }
+        serving = now_serving_.load(std::memory_order_acquire);
+    }
+}
+
+void ticket_mutex::unlock(std::size_t) {
+    // only the holder writes now_serving_
+    now_serving_.store(now_serving_.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_release);
+}
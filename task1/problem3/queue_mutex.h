@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+const std::size_t CACHE_LINE_SIZE = 64;
+const std::size_t SPINS_BEFORE_YIELD = 128; // busy waits before giving the core away
+const std::size_t TICKET_BACKOFF = 32; // pauses per thread ahead in the ticket queue
+
+// one step of a wait loop: pause while young, then yield; machines with
+// one core yield at once
+void spin_wait(std::size_t& spins);
+
+// Queue locks with the tree_mutex interface. Every waiter spins on a
+// flag in its own cache line, a release touches one line of the next
+// waiter only. Thread indices must be below num_threads and used by one
+// thread at a time.
+
+// Mellor-Crummey, Scott: waiters link their nodes into a queue, each one
+// spins on its own node until the predecessor hands the lock over.
+class mcs_mutex {
+public:
+    explicit mcs_mutex(std::size_t num_threads);
+    void lock(std::size_t thread_index);
+    void unlock(std::size_t thread_index);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) node_ {
+        std::atomic<node_*> next;
+        std::atomic<bool> locked;
+    };
+    std::unique_ptr<node_[]> nodes_; // one per thread
+    alignas(CACHE_LINE_SIZE) std::atomic<node_*> tail_;
+};
+
+// Craig, Landin, Hagersten: a waiter spins on the node of its predecessor
+// and takes that node over on unlock, so nodes wander between threads.
+class clh_mutex {
+public:
+    explicit clh_mutex(std::size_t num_threads);
+    void lock(std::size_t thread_index);
+    void unlock(std::size_t thread_index);
+
+private:
+    struct alignas(CACHE_LINE_SIZE) node_ {
+        std::atomic<bool> locked;
+    };
+    struct alignas(CACHE_LINE_SIZE) thread_ {
+        node_* node; // published on lock, released on unlock
+        node_* predecessor; // becomes the node of the thread after unlock
+    };
+    std::unique_ptr<node_[]> nodes_; // one per thread and the initial tail
+    std::unique_ptr<thread_[]> threads_;
+    alignas(CACHE_LINE_SIZE) std::atomic<node_*> tail_;
+};
+
+// FIFO ticket lock with backoff proportional to the distance from the
+// head of the queue, so that only the next thread polls often. It keeps
+// no per-thread state, the index is accepted for interface compatibility.
+class ticket_mutex {
+public:
+    explicit ticket_mutex(std::size_t num_threads);
+    void lock(std::size_t thread_index);
+    void unlock(std::size_t thread_index);
+
+private:
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> next_ticket_;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> now_serving_;
+};
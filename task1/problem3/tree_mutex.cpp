@@ -1,6 +1,5 @@
 #include "tree_mutex.h"
-#include <thread>
-#include <algorithm>
+#include "../../task6/spsc_ring_buffer/event_tracer.h"
 
 mutex::mutex() {
     want_[0].store(false);
@@ -11,8 +10,9 @@ mutex::mutex() {
 void mutex::lock(int thread_index) {
     want_[thread_index].store(true);
     victim_.store(thread_index);
+    std::size_t spins = 0;
     while (want_[1 - thread_index].load() && victim_.load() == thread_index) {
-        std::this_thread::yield(); // wait
+        spin_wait(spins);
     }
 }
 
@@ -20,46 +20,47 @@ void mutex::unlock(int thread_index) {
     want_[thread_index].store(false);
 }
 
-tree_mutex::tree_mutex(std::size_t num_threads) : mutexes_(tree_size_(num_threads)) {
-    levels_ = static_cast<std::size_t>(ceil(log2(num_threads)));
+tree_mutex::tree_mutex(std::size_t num_threads) : levels_(0) {
+    std::size_t num_leaves = 1;
+    while (num_leaves < num_threads) {
+        num_leaves *= 2;
+        ++levels_;
+    }
+    leaf_offset_ = num_leaves - 1;
+    mutexes_ = std::vector<mutex>(leaf_offset_);
+    is_shared_.resize(leaf_offset_);
+    for (std::size_t vertex = 0; vertex < leaf_offset_; ++vertex) {
+        // the leftmost leaf of the right subtree decides
+        std::size_t leaf = 2 * vertex + 2;
+        while (leaf < leaf_offset_) {
+            leaf = 2 * leaf + 1;
+        }
+        is_shared_[vertex] = leaf - leaf_offset_ < num_threads;
+    }
 }
 
 void tree_mutex::lock(std::size_t thread_index) {
-    auto vertex = static_cast<int>(mutexes_.size() - pow(2, levels_) + thread_index);
+    TRACE_SCOPE("tree_mutex::lock");
+    std::size_t vertex = leaf_offset_ + thread_index;
     // traverse the tree from leaves to root
     while (vertex > 0) {
-        if (vertex % 2 == 0) {
-            vertex = (vertex - 2) / 2;
-            mutexes_[vertex].lock(0);
-        } else {
-            vertex = (vertex - 1) / 2;
-            mutexes_[vertex].lock(1);
+        int side = vertex % 2; // 1 for a left child
+        vertex = (vertex - 1) / 2;
+        if (is_shared_[vertex]) {
+            mutexes_[vertex].lock(side);
         }
     }
 }
 
 void tree_mutex::unlock(std::size_t thread_index) {
-    std::vector<int> path;
-    auto vertex = static_cast<int>(mutexes_.size() - pow(2, levels_) + thread_index);
-    while (vertex >= 0) { // build path from leaves to root
-        path.push_back(vertex);
-        if (vertex % 2 == 0) {
-            vertex = (vertex - 2) / 2;
-        } else {
-            vertex = (vertex - 1) / 2;
-        }
-    }
+    // in 1-based heap numbering the ancestor k levels up is (leaf + 1) >> k
+    std::size_t leaf = leaf_offset_ + thread_index + 1;
     // traverse the tree from root to leaves
-    for (auto i = path.rbegin(); i < path.rend() - 1; ++i) {
-        mutexes_[*i].unlock(*(i + 1) % 2); // unlock mutexes
-    }
-}
-
-std::size_t tree_mutex::tree_size_(std::size_t num_threads) {
-    auto levels = static_cast<std::size_t>(ceil(log2(num_threads)));
-    std::size_t tree_size = 0;
-    for (std::size_t i = 0; i <= levels; ++i) {
-        tree_size += pow(2, i);
+    for (std::size_t level = levels_; level > 0; --level) {
+        std::size_t vertex = (leaf >> level) - 1;
+        if (is_shared_[vertex]) {
+            int side = ((leaf >> (level - 1)) - 1) % 2;
+            mutexes_[vertex].unlock(side);
+        }
     }
-    return tree_size;
 }
@@ -1,9 +1,12 @@
-#include <iostream>
-#include <vector>
+#pragma once
+
+#include "queue_mutex.h"
 #include <atomic>
 #include <array>
+#include <vector>
 
-class mutex {
+// Peterson lock for two threads, alone on its cache line
+class alignas(CACHE_LINE_SIZE) mutex {
 public:
     mutex();
     void lock(int thread_index);
@@ -14,6 +17,9 @@ private:
     std::atomic<int> victim_;
 };
 
+// Tournament tree of Peterson locks: a thread climbs from its leaf to the
+// root. Threads fill the leaves from the left, a node with no thread in
+// its right subtree is never contended and is skipped.
 class tree_mutex {
 public:
     tree_mutex(std::size_t num_threads);
@@ -21,7 +27,8 @@ public:
     void unlock(std::size_t thread_index);
 
 private:
-    std::size_t tree_size_(std::size_t num_threads); // get size of the tree
-    std::vector<mutex> mutexes_; // tree of mutexes
+    std::vector<mutex> mutexes_; // inner nodes as a heap, leaves are implicit
+    std::vector<bool> is_shared_; // both subtrees of the node have threads
+    std::size_t leaf_offset_; // heap index of the leaf of thread 0
     std::size_t levels_; // height of the tree
 };
@@ -0,0 +1,166 @@
+// Acquire/release latency of tree_mutex against the submitted version of
+// the same lock (yandex/tree_mutex.h) and std::mutex.
+// usage: tree_mutex_benchmark [max threads] [acquisitions per thread]
+#include "tree_mutex.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The submitted version (yandex/tree_mutex.h), copied under other names:
+// it predates the rework and defines the same class names
+class submitted_mutex {
+public:
+    submitted_mutex() {
+        want[0].store(false);
+        want[1].store(false);
+        victim.store(0);
+    }
+    void lock(int thread_index) {
+        want[thread_index].store(true);
+        victim.store(thread_index);
+        while (want[1 - thread_index].load() && victim.load() == thread_index) {
+            std::this_thread::yield();
+        }
+    }
+    void unlock(int thread_index) { want[thread_index].store(false); }
+
+private:
+    std::array<std::atomic<bool>, 2> want;
+    std::atomic<int> victim;
+};
+
+class submitted_tree_mutex {
+public:
+    explicit submitted_tree_mutex(std::size_t num_threads)
+            : mutexes(realsize(num_threads)),
+              levels(static_cast<std::size_t>(std::ceil(std::log2(num_threads)))) {
+    }
+    void lock(std::size_t thread_index) {
+        int vertex = static_cast<int>(mutexes.size() - std::pow(2, levels) + thread_index);
+        while (vertex > 0) {
+            if (vertex % 2 == 0) {
+                vertex = (vertex - 2) / 2;
+                mutexes[vertex].lock(0);
+            } else {
+                vertex = (vertex - 1) / 2;
+                mutexes[vertex].lock(1);
+            }
+        }
+    }
+    void unlock(std::size_t thread_index) {
+        std::vector<int> path;
+        int vertex = static_cast<int>(mutexes.size() - std::pow(2, levels) + thread_index);
+        while (vertex >= 0) {
+            path.push_back(vertex);
+            if (vertex % 2 == 0) {
+                vertex = (vertex - 2) / 2;
+            } else {
+                vertex = (vertex - 1) / 2;
+            }
+        }
+        for (auto i = path.rbegin(); i < path.rend() - 1; ++i) {
+            mutexes[*i].unlock(*(i + 1) % 2);
+        }
+    }
+
+private:
+    std::vector<submitted_mutex> mutexes;
+    std::size_t levels;
+
+    static std::size_t realsize(std::size_t size) {
+        std::size_t levels = static_cast<std::size_t>(std::ceil(std::log2(size)));
+        std::size_t realsize = 0;
+        for (std::size_t i = 0; i <= levels; ++i) {
+            realsize += std::pow(2, i);
+        }
+        return realsize;
+    }
+};
+
+const std::size_t DEFAULT_MAX_THREADS = 8;
+const std::size_t DEFAULT_ACQUISITIONS = 200000;
+
+struct std_mutex {
+    explicit std_mutex(std::size_t) {}
+    void lock(std::size_t) { mutex.lock(); }
+    void unlock(std::size_t) { mutex.unlock(); }
+    std::mutex mutex;
+};
+
+using clock_type = std::chrono::steady_clock;
+
+double percentile(std::vector<double>& samples, double share) {
+    std::size_t index = static_cast<std::size_t>(share * (samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+template <class Lock>
+void run(const std::string& name, std::size_t num_threads, std::size_t acquisitions) {
+    Lock lock(num_threads);
+    std::vector<std::vector<double>> acquire_ns(num_threads), release_ns(num_threads);
+    std::size_t counter = 0;
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 0; thread < num_threads; ++thread) {
+        threads.emplace_back([&, thread] {
+            std::vector<double>& acquire = acquire_ns[thread];
+            std::vector<double>& release = release_ns[thread];
+            acquire.reserve(acquisitions);
+            release.reserve(acquisitions);
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (std::size_t i = 0; i < acquisitions; ++i) {
+                auto before = clock_type::now();
+                lock.lock(thread);
+                auto locked = clock_type::now();
+                ++counter;
+                lock.unlock(thread);
+                auto after = clock_type::now();
+                acquire.push_back(std::chrono::duration<double, std::nano>(locked - before).count());
+                release.push_back(std::chrono::duration<double, std::nano>(after - locked).count());
+            }
+        });
+    }
+    auto begin = clock_type::now();
+    start.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(clock_type::now() - begin).count();
+    if (counter != num_threads * acquisitions) {
+        std::cerr << name << " lost updates" << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<double> acquire, release;
+    for (std::size_t thread = 0; thread < num_threads; ++thread) {
+        acquire.insert(acquire.end(), acquire_ns[thread].begin(), acquire_ns[thread].end());
+        release.insert(release.end(), release_ns[thread].begin(), release_ns[thread].end());
+    }
+    std::cout << name << ',' << num_threads << ',' << counter / seconds / 1e6 << ','
+              << percentile(acquire, 0.5) << ',' << percentile(acquire, 0.99) << ','
+              << percentile(release, 0.5) << ',' << percentile(release, 0.99) << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::size_t max_threads = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_MAX_THREADS;
+    std::size_t acquisitions = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_ACQUISITIONS;
+
+    std::cout << "lock,threads,mops,acquire_p50_ns,acquire_p99_ns,release_p50_ns,release_p99_ns\n";
+    for (std::size_t num_threads = 1; num_threads <= max_threads; ++num_threads) {
+        run<submitted_tree_mutex>("submitted_tree_mutex", num_threads, acquisitions);
+        run<tree_mutex>("tree_mutex", num_threads, acquisitions);
+        run<std_mutex>("std_mutex", num_threads, acquisitions);
+    }
+    return 0;
+}
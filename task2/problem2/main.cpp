@@ -1,51 +1,168 @@
 #include "thread_safe_queue.h"
+#include "primality.h"
+#include "../../task6/spsc_ring_buffer/spsc_ring_buffer.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
 #include <thread>
+#include <vector>
 
-const int RANDOM_NUMBERS = 100000;
-const int MAX_NUMBER = 10000;
-const int POISON_PILL = -1;
-const int CONSUMERS = 4;
+// Producer/consumer pipeline: the producer draws random numbers in batches,
+// consumers count the primes of each batch and keep their own totals.
+// usage: main [numbers] [consumers] [mutex|spsc] [max number]
 
-thread_safe_queue<int> queue(20);
+const std::size_t RANDOM_NUMBERS = 10000000;
+const std::uint32_t MAX_NUMBER = UINT32_MAX;
+const std::size_t CONSUMERS = 4;
+const std::size_t BATCH_SIZE = 1024;
+const std::size_t QUEUE_BATCHES = 20; // capacity of a queue, in batches
 
-void generate(int number) {
-    for (int i = 0; i < number; ++i) {
-        int random_number = rand() % MAX_NUMBER;
-        queue.enqueue(random_number);
+struct batch {
+    std::size_t size;
+    std::array<std::uint32_t, BATCH_SIZE> numbers;
+};
+batch* const POISON_PILL = nullptr;
+
+// padded, consumers never write to the same cache line
+struct alignas(64) consumer_result {
+    std::uint64_t numbers = 0;
+    std::uint64_t primes = 0;
+};
+
+// One bounded blocking queue shared by all consumers
+class mutex_engine {
+public:
+    explicit mutex_engine(std::size_t) : queue_(QUEUE_BATCHES) {}
+    void push(batch* item) { queue_.enqueue(item); }
+    batch* pop(std::size_t) {
+        batch* item;
+        queue_.pop(item);
+        return item;
     }
-    for (int i = 0; i < CONSUMERS; ++i) {
-        queue.enqueue(POISON_PILL);
+    void close(std::size_t num_consumers) {
+        for (std::size_t i = 0; i < num_consumers; ++i) {
+            queue_.enqueue(POISON_PILL);
+        }
     }
-}
 
-void is_prime() {
-    while (true) {
-        int number = -1;
-        queue.pop(number);
-        if (number != POISON_PILL) {
-            bool is_prime = true;
-            for (int i = 2; i <= number / 2; ++i) {
-                if (number % i == 0) {
-                    is_prime = false;
-                    break;
-                }
+private:
+    bounded_thread_safe_queue<batch*> queue_;
+};
+
+// A lock-free ring per consumer, the producer deals batches round-robin
+// and skips full rings
+class spsc_engine {
+public:
+    explicit spsc_engine(std::size_t num_consumers) : next_(0) {
+        for (std::size_t i = 0; i < num_consumers; ++i) {
+            rings_.emplace_back(new spsc_ring_buffer<batch*>(QUEUE_BATCHES));
+        }
+    }
+    void push(batch* item) {
+        while (!rings_[next_]->enqueue(item)) {
+            next_ = (next_ + 1) % rings_.size();
+            std::this_thread::yield();
+        }
+        next_ = (next_ + 1) % rings_.size();
+    }
+    batch* pop(std::size_t consumer) {
+        batch* item;
+        while (!rings_[consumer]->dequeue(item)) {
+            std::this_thread::yield();
+        }
+        return item;
+    }
+    void close(std::size_t) {
+        for (auto& ring : rings_) {
+            while (!ring->enqueue(POISON_PILL)) {
+                std::this_thread::yield();
             }
-        } else {
-            return;
         }
     }
+
+private:
+    std::vector<std::unique_ptr<spsc_ring_buffer<batch*>>> rings_;
+    std::size_t next_;
+};
+
+template <class Engine>
+void generate(Engine& queue, std::size_t count, std::uint32_t max_number,
+              std::size_t num_consumers) {
+    std::mt19937 random(42);
+    std::uniform_int_distribution<std::uint32_t> distribution(0, max_number);
+    for (std::size_t first = 0; first < count; first += BATCH_SIZE) {
+        batch* item = new batch;
+        item->size = std::min(BATCH_SIZE, count - first);
+        for (std::size_t i = 0; i < item->size; ++i) {
+            item->numbers[i] = distribution(random);
+        }
+        queue.push(item);
+    }
+    queue.close(num_consumers);
 }
 
-int main() {
-    std::thread producer(generate, RANDOM_NUMBERS);
-    std::array<std::thread, CONSUMERS> consumer;
+template <class Engine>
+void count_primes(Engine& queue, std::size_t consumer, consumer_result& result) {
+    std::array<std::uint8_t, BATCH_SIZE> is_prime;
+    while (batch* item = queue.pop(consumer)) {
+        test_primes(item->numbers.data(), item->size, is_prime.data());
+        for (std::size_t i = 0; i < item->size; ++i) {
+            result.primes += is_prime[i];
+        }
+        result.numbers += item->size;
+        delete item;
+    }
+}
+
+template <class Engine>
+int run(std::size_t count, std::size_t num_consumers, std::uint32_t max_number) {
+    Engine queue(num_consumers);
+    std::vector<consumer_result> results(num_consumers);
+    auto start = std::chrono::steady_clock::now();
 
-    for (int i = 0; i < consumer.size(); ++i) {
-        consumer[i] = std::thread(is_prime);
+    std::thread producer([&] { generate(queue, count, max_number, num_consumers); });
+    std::vector<std::thread> consumers;
+    for (std::size_t i = 0; i < num_consumers; ++i) {
+        consumers.emplace_back([&, i] { count_primes(queue, i, results[i]); });
     }
     producer.join();
-    for (int i = 0; i < consumer.size(); ++i) {
-        consumer[i].join();
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    consumer_result total;
+    for (const auto& result : results) {
+        total.numbers += result.numbers;
+        total.primes += result.primes;
+    }
+    std::cout << "numbers,primes,consumers,seconds,numbers_per_second\n"
+              << total.numbers << ',' << total.primes << ',' << num_consumers << ','
+              << seconds << ',' << total.numbers / seconds << std::endl;
+    return total.numbers == count ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : RANDOM_NUMBERS;
+    std::size_t num_consumers = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : CONSUMERS;
+    std::string engine = argc > 3 ? argv[3] : "mutex";
+    std::uint32_t max_number = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : MAX_NUMBER;
+    if (num_consumers < 1) {
+        std::cerr << "At least one consumer is needed." << std::endl;
+        return 1;
+    }
+    if (engine == "spsc") {
+        return run<spsc_engine>(count, num_consumers, max_number);
+    }
+    if (engine != "mutex") {
+        std::cerr << "Unknown queue engine " << engine << std::endl;
+        return 1;
     }
-    return 0;
+    return run<mutex_engine>(count, num_consumers, max_number);
 }
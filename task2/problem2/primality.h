@@ -0,0 +1,155 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const std::uint32_t SIEVE_LIMIT = 1 << 16; // numbers below are looked up
+const std::uint32_t TRIAL_PRIME_LIMIT = 256; // odd primes below are tried as divisors
+const std::size_t PRIME_LANES = 8; // numbers run through Miller-Rabin side by side
+
+// Sieve of Eratosthenes below SIEVE_LIMIT
+inline const std::vector<bool>& small_primes() {
+    static const std::vector<bool> sieve = [] {
+        std::vector<bool> is_prime(SIEVE_LIMIT, true);
+        is_prime[0] = is_prime[1] = false;
+        for (std::uint32_t i = 2; i * i < SIEVE_LIMIT; ++i) {
+            if (is_prime[i]) {
+                for (std::uint32_t j = i * i; j < SIEVE_LIMIT; j += i) {
+                    is_prime[j] = false;
+                }
+            }
+        }
+        return is_prime;
+    }();
+    return sieve;
+}
+
+// n is divisible by an odd p exactly when n * p^-1 mod 2^32 <= (2^32 - 1) / p
+// (Granlund, Montgomery): a multiply and a compare, no division
+struct trial_divisor {
+    std::uint32_t inverse;
+    std::uint32_t limit;
+};
+
+inline const std::vector<trial_divisor>& trial_divisors() {
+    static const std::vector<trial_divisor> divisors = [] {
+        std::vector<trial_divisor> result;
+        const std::vector<bool>& sieve = small_primes();
+        for (std::uint32_t p = 3; p < TRIAL_PRIME_LIMIT; p += 2) {
+            if (sieve[p]) {
+                // Newton iteration for p^-1 mod 2^32, each step doubles the correct bits
+                std::uint32_t inverse = p;
+                for (int i = 0; i < 4; ++i) {
+                    inverse *= 2 - p * inverse;
+                }
+                result.push_back({inverse, UINT32_MAX / p});
+            }
+        }
+        return result;
+    }();
+    return divisors;
+}
+
+// Montgomery product a * b / 2^32 mod n for odd n, a and b below n.
+// Subtracting instead of adding m * n keeps the sum from overflowing.
+inline std::uint64_t montgomery_multiply(std::uint64_t a, std::uint64_t b, std::uint64_t n,
+                                         std::uint64_t n_inverse) {
+    std::uint64_t product = a * b;
+    std::uint64_t m = (product * n_inverse) & 0xFFFFFFFF;
+    std::uint64_t high = product >> 32;
+    std::uint64_t correction = (m * n) >> 32;
+    return high - correction + (high < correction ? n : 0);
+}
+
+// Deterministic Miller-Rabin for odd 32-bit numbers above 61 (bases 2, 7
+// and 61) on PRIME_LANES numbers at once. Every lane runs the same fixed
+// sequence of Montgomery steps and masks out what it does not need: the
+// lanes are independent dependency chains that the core overlaps.
+inline void miller_rabin_lanes(const std::uint32_t* numbers, std::uint8_t* is_prime) {
+    static const std::uint64_t BASES[] = {2, 7, 61};
+    std::uint64_t n[PRIME_LANES], n_inverse[PRIME_LANES], one[PRIME_LANES];
+    std::uint64_t minus_one[PRIME_LANES], r_squared[PRIME_LANES];
+    std::uint64_t exponent[PRIME_LANES], shifts[PRIME_LANES], composite[PRIME_LANES];
+    for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+        std::uint32_t odd = numbers[lane];
+        std::uint32_t inverse = odd;
+        for (int i = 0; i < 4; ++i) {
+            inverse *= 2 - odd * inverse;
+        }
+        n[lane] = odd;
+        n_inverse[lane] = inverse;
+        one[lane] = (std::uint64_t(1) << 32) % odd; // 1 in Montgomery form
+        minus_one[lane] = odd - one[lane];
+        r_squared[lane] = one[lane] * one[lane] % odd;
+        shifts[lane] = __builtin_ctz(odd - 1);
+        exponent[lane] = (odd - 1) >> shifts[lane];
+        composite[lane] = 0;
+    }
+    for (std::uint64_t base : BASES) {
+        std::uint64_t x[PRIME_LANES], power[PRIME_LANES], passed[PRIME_LANES];
+        for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+            power[lane] = montgomery_multiply(base, r_squared[lane], n[lane], n_inverse[lane]);
+            x[lane] = one[lane];
+        }
+        // base^exponent, square and multiply over all 32 bits
+        for (int bit = 31; bit >= 0; --bit) {
+            for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+                x[lane] = montgomery_multiply(x[lane], x[lane], n[lane], n_inverse[lane]);
+                std::uint64_t product = montgomery_multiply(x[lane], power[lane], n[lane],
+                                                            n_inverse[lane]);
+                x[lane] = (exponent[lane] >> bit) & 1 ? product : x[lane];
+            }
+        }
+        for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+            passed[lane] = x[lane] == one[lane] || x[lane] == minus_one[lane];
+        }
+        for (std::uint64_t square = 1; square < 32; ++square) {
+            for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+                x[lane] = montgomery_multiply(x[lane], x[lane], n[lane], n_inverse[lane]);
+                passed[lane] |= square < shifts[lane] && x[lane] == minus_one[lane];
+            }
+        }
+        for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+            composite[lane] |= !passed[lane];
+        }
+    }
+    for (std::size_t lane = 0; lane < PRIME_LANES; ++lane) {
+        is_prime[lane] = !composite[lane];
+    }
+}
+
+// is_prime[i] for numbers[i], i < count. Small numbers are looked up,
+// the rest go through trial division by small primes across the whole
+// batch (the loop the compiler vectorizes), and only the survivors, about
+// one in ten, through Miller-Rabin.
+inline void test_primes(const std::uint32_t* numbers, std::size_t count, std::uint8_t* is_prime) {
+    for (std::size_t i = 0; i < count; ++i) {
+        is_prime[i] = numbers[i] & 1;
+    }
+    for (const trial_divisor& divisor : trial_divisors()) {
+        for (std::size_t i = 0; i < count; ++i) {
+            is_prime[i] &= numbers[i] * divisor.inverse > divisor.limit;
+        }
+    }
+    const std::vector<bool>& sieve = small_primes();
+    std::vector<std::uint32_t> candidates;
+    std::vector<std::size_t> positions;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (numbers[i] < SIEVE_LIMIT) {
+            is_prime[i] = sieve[numbers[i]];
+        } else if (is_prime[i]) {
+            candidates.push_back(numbers[i]);
+            positions.push_back(i);
+        }
+    }
+    // pad to whole lanes with a known prime
+    while (candidates.size() % PRIME_LANES != 0) {
+        candidates.push_back(SIEVE_LIMIT + 1);
+    }
+    std::uint8_t results[PRIME_LANES];
+    for (std::size_t first = 0; first < candidates.size(); first += PRIME_LANES) {
+        miller_rabin_lanes(&candidates[first], results);
+        for (std::size_t lane = 0; lane < PRIME_LANES && first + lane < positions.size(); ++lane) {
+            is_prime[positions[first + lane]] = results[lane];
+        }
+    }
+}
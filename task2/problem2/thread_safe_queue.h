@@ -2,17 +2,19 @@
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include "../../task6/spsc_ring_buffer/event_tracer.h"
 
+// Blocking queue with limited capacity, enqueue waits while it is full
 template<typename T>
-class thread_safe_queue {
+class bounded_thread_safe_queue {
 public:
-    thread_safe_queue(std::size_t capacity);
-    thread_safe_queue(const thread_safe_queue& queue) = delete;
+    bounded_thread_safe_queue(std::size_t capacity);
+    bounded_thread_safe_queue(const bounded_thread_safe_queue& queue) = delete;
     void enqueue(T item);
     void pop(T& item);
 
 private:
-    std::condition_variable empty_4 ;
+    std::condition_variable empty_;
     std::condition_variable overloaded_;
     std::mutex mutex_;
     std::queue<T> queue_;
@@ -20,12 +22,12 @@ private:
 };
 
 template<typename T>
-thread_safe_queue<T>::thread_safe_queue(std::size_t capacity)
+bounded_thread_safe_queue<T>::bounded_thread_safe_queue(std::size_t capacity)
         : capacity_(capacity) {
 }
 
 template<typename T>
-void thread_safe_queue<T>::enqueue(T item) {
+void bounded_thread_safe_queue<T>::enqueue(T item) {
     std::unique_lock<std::mutex> lock(mutex_);
 
     auto not_overloaded = [this] { return queue_.size() < capacity_; };
@@ -37,11 +39,14 @@ void thread_safe_queue<T>::enqueue(T item) {
 }
 
 template<typename T>
-void thread_safe_queue<T>::pop(T& item) {
+void bounded_thread_safe_queue<T>::pop(T& item) {
     std::unique_lock<std::mutex> lock(mutex_);
 
     auto not_empty = [this] { return !queue_.empty(); };
-    empty_.wait(lock, not_empty);
+    if (!not_empty()) {
+        TRACE_SCOPE("bounded_thread_safe_queue::pop blocked");
+        empty_.wait(lock, not_empty);
+    }
 
     item = queue_.front();
     queue_.pop();
@@ -26,16 +26,21 @@ task<R>::task(std::shared_ptr<std::promise<R>> promise, std::function<R()> funct
         : is_poison_pill_(false), function_(function), promise_(promise) {
 }
 
+// periodic tasks have no promise, their results and exceptions are dropped
 template <class R>
 void task<R>::run() const {
     R returned;
     try {
         returned = function_();
     } catch (...) {
-        promise_->set_exception(std::current_exception());
+        if (promise_) {
+            promise_->set_exception(std::current_exception());
+        }
         return;
     }
-    promise_->set_value(returned);
+    if (promise_) {
+        promise_->set_value(returned);
+    }
 }
 
 template <class R>
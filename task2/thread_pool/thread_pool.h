@@ -1,14 +1,31 @@
 #include "thread_safe_queue.h"
 #include "task.h"
+#include "timing_wheel.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
 #include <future>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 const int NUM_THREADS = 8;
+const std::chrono::milliseconds TIMER_TICK(1); // resolution of delayed tasks
+
+template <typename R>
+struct scheduled_task {
+    std::future<R> future; // broken promise if the task is cancelled
+    timer_id id;
+};
 
 template <typename R>
 class thread_pool {
 public:
+    using clock_type = std::chrono::steady_clock;
+
     thread_pool();
     explicit thread_pool(std::size_t num_threads); // number of workers
     thread_pool(const thread_pool& lhs) = delete; // rule of 5
@@ -20,22 +37,44 @@ public:
     thread_pool& operator=(thread_pool&& rhs) = default;
 
     std::future<R> submit(std::function<R()> function);
+    // queued at the first tick at or after the given time
+    scheduled_task<R> submit_at(clock_type::time_point time, std::function<R()> function);
+    scheduled_task<R> submit_after(clock_type::duration delay, std::function<R()> function);
+    // queued every period starting one period from now, results are dropped
+    timer_id submit_periodic(clock_type::duration period, std::function<R()> function);
+    // false if the task has already been queued for the last time
+    bool cancel(timer_id id);
     void shutdown();
 
 private:
     thread_safe_queue<task<R>> queue_;
     std::vector<std::thread> workers_;
     bool is_shutdowned_;
+
+    // a single timer thread moves due tasks into queue_, started on first use
+    std::mutex timer_mutex_;
+    std::condition_variable timers_changed_;
+    timing_wheel<task<R>> timers_;
+    clock_type::time_point epoch_; // tick zero of timers_
+    std::uint64_t timer_wakeup_; // tick the timer thread sleeps until
+    bool is_timer_stopped_;
+    std::thread timer_thread_;
+
+    std::uint64_t ticks_until_(clock_type::time_point time) const; // rounded up
+    timer_id schedule_(std::uint64_t deadline, std::uint64_t period, task<R> scheduled);
+    void run_timers_();
 };
 
 template <typename R>
-thread_pool<R>::thread_pool() : is_shutdowned_(false) {
-    thread_pool(NUM_THREADS);
+thread_pool<R>::thread_pool() : thread_pool(NUM_THREADS) {
 }
 
 template <typename R>
 thread_pool<R>::thread_pool(std::size_t num_threads)
-        : is_shutdowned_(false) {
+        : is_shutdowned_(false),
+          epoch_(clock_type::now()),
+          timer_wakeup_(UINT64_MAX),
+          is_timer_stopped_(false) {
     auto run = [this] {
         task<R> current;
         queue_.pop(current);
@@ -66,8 +105,105 @@ std::future<R> thread_pool<R>::submit(std::function<R()> function) {
     return promise->get_future();
 }
 
+template <typename R>
+std::uint64_t thread_pool<R>::ticks_until_(clock_type::time_point time) const {
+    if (time <= epoch_) {
+        return 0;
+    }
+    auto elapsed = time - epoch_;
+    std::uint64_t ticks = elapsed / TIMER_TICK;
+    return ticks * TIMER_TICK < elapsed ? ticks + 1 : ticks;
+}
+
+template <typename R>
+scheduled_task<R> thread_pool<R>::submit_at(clock_type::time_point time,
+                                            std::function<R()> function) {
+    auto promise = std::make_shared<std::promise<R>>();
+    scheduled_task<R> scheduled;
+    scheduled.future = promise->get_future();
+    scheduled.id = schedule_(ticks_until_(time), 0, task<R>(promise, function));
+    return scheduled;
+}
+
+template <typename R>
+scheduled_task<R> thread_pool<R>::submit_after(clock_type::duration delay,
+                                               std::function<R()> function) {
+    return submit_at(clock_type::now() + delay, function);
+}
+
+template <typename R>
+timer_id thread_pool<R>::submit_periodic(clock_type::duration period,
+                                         std::function<R()> function) {
+    if (period <= clock_type::duration::zero()) {
+        throw std::invalid_argument("Period must be positive.");
+    }
+    std::uint64_t period_ticks = ticks_until_(epoch_ + period);
+    return schedule_(ticks_until_(clock_type::now() + period), period_ticks,
+                     task<R>(nullptr, function));
+}
+
+template <typename R>
+timer_id thread_pool<R>::schedule_(std::uint64_t deadline, std::uint64_t period,
+                                   task<R> scheduled) {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    if (is_timer_stopped_) {
+        throw std::exception();
+    }
+    if (!timer_thread_.joinable()) {
+        timer_thread_ = std::thread([this] { run_timers_(); });
+    }
+    timer_id id = timers_.insert(deadline, period, std::move(scheduled));
+    // the timer thread sleeps until its next event, wake it for an earlier one
+    if (deadline < timer_wakeup_) {
+        timer_wakeup_ = deadline;
+        timers_changed_.notify_one();
+    }
+    return id;
+}
+
+template <typename R>
+bool thread_pool<R>::cancel(timer_id id) {
+    std::lock_guard<std::mutex> lock(timer_mutex_);
+    return timers_.cancel(id);
+}
+
+template <typename R>
+void thread_pool<R>::run_timers_() {
+    std::vector<task<R>> due;
+    std::unique_lock<std::mutex> lock(timer_mutex_);
+    while (!is_timer_stopped_) {
+        std::uint64_t now = (clock_type::now() - epoch_) / TIMER_TICK;
+        timers_.advance(now, [&due](task<R>&& ready) { due.push_back(std::move(ready)); });
+        if (!due.empty()) {
+            // workers take the queue lock once per batch, not per timer
+            lock.unlock();
+            queue_.enqueue_batch(due);
+            due.clear();
+            lock.lock();
+            continue;
+        }
+        if (timers_.size() == 0) {
+            timer_wakeup_ = UINT64_MAX;
+            timers_changed_.wait(lock);
+        } else {
+            timer_wakeup_ = timers_.now() + timers_.next_event();
+            timers_changed_.wait_until(lock, epoch_ + timer_wakeup_ * TIMER_TICK);
+        }
+    }
+}
+
 template <typename R>
 void thread_pool<R>::shutdown() {
+    // pending timers are dropped, their futures get a broken promise
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        is_timer_stopped_ = true;
+        timers_.clear();
+    }
+    timers_changed_.notify_one();
+    if (timer_thread_.joinable()) {
+        timer_thread_.join();
+    }
     for (std::size_t i = 0; i < workers_.size(); ++i) {
         task<R> poison_pill;
         poison_pill.make_poison_pill();
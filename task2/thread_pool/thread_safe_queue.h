@@ -2,6 +2,8 @@
 #include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <vector>
+#include "../../task6/spsc_ring_buffer/event_tracer.h"
 
 // Blocking queue with unlimited capacity
 template<typename T>
@@ -10,6 +12,7 @@ public:
     thread_safe_queue();
     thread_safe_queue(const thread_safe_queue& queue) = delete;
     void enqueue(T item);
+    void enqueue_batch(std::vector<T>& items); // moves them in under one lock
     void pop(T& item);
 
 private:
@@ -30,12 +33,29 @@ void thread_safe_queue<T>::enqueue(T item) {
     empty_.notify_one();
 }
 
+template<typename T>
+void thread_safe_queue<T>::enqueue_batch(std::vector<T>& items) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (auto& item : items) {
+        queue_.push(std::move(item));
+    }
+    lock.unlock();
+    if (items.size() == 1) {
+        empty_.notify_one();
+    } else {
+        empty_.notify_all();
+    }
+}
+
 template<typename T>
 void thread_safe_queue<T>::pop(T& item) {
     std::unique_lock<std::mutex> lock(mutex_);
 
     auto not_empty = [this] { return !queue_.empty(); };
-    empty_.wait(lock, not_empty);
+    if (!not_empty()) {
+        TRACE_SCOPE("thread_safe_queue::pop blocked");
+        empty_.wait(lock, not_empty);
+    }
 
     item = queue_.front();
     queue_.pop();
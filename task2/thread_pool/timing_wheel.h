@@ -0,0 +1,266 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// handle of a pending timer: generation in the high half, node in the low one
+using timer_id = std::uint64_t;
+
+const std::size_t WHEEL_LEVELS = 4;
+const std::size_t WHEEL_SLOT_BITS = 8;
+const std::size_t WHEEL_SLOTS = std::size_t(1) << WHEEL_SLOT_BITS;
+const std::size_t WHEEL_NODES_PER_CHUNK = 4096;
+
+// Hierarchical timing wheel (Varghese, Lauck, 1987) over integer ticks.
+// Level i has 256 slots of 256^i ticks each; a timer sits in the level of
+// its distance to the deadline and moves down a level whenever the wheel
+// reaches its slot. Timers are nodes of intrusive lists inside chunks that
+// never move, so insert and cancel are O(1). Not synchronized: the owner locks.
+template <typename Value>
+class timing_wheel {
+public:
+    timing_wheel();
+    timing_wheel(const timing_wheel&) = delete;
+    timing_wheel& operator=(const timing_wheel&) = delete;
+
+    // fires at deadline, then every period ticks unless period is zero;
+    // a deadline already passed fires on the next tick
+    timer_id insert(std::uint64_t deadline, std::uint64_t period, Value value);
+    // false if the timer has fired for the last time or was cancelled
+    bool cancel(timer_id id);
+    // moves the wheel to tick now and hands every due value to visitor(Value&&),
+    // periodic timers hand over a copy
+    template <class Visitor>
+    void advance(std::uint64_t now, Visitor visitor);
+    // ticks from now() to the next tick that has timers to fire or move
+    std::uint64_t next_event() const;
+    void clear();
+
+    std::uint64_t now() const noexcept { return current_; }
+    std::size_t size() const noexcept { return size_; }
+
+private:
+    static const std::uint32_t NIL_ = UINT32_MAX;
+
+    struct node_ {
+        std::uint64_t deadline = 0;
+        std::uint64_t period = 0;
+        std::uint32_t generation = 1; // bumped on release, old ids stop matching
+        std::uint32_t slot = NIL_; // level * WHEEL_SLOTS + slot, NIL_ when free
+        std::uint32_t prev = NIL_;
+        std::uint32_t next = NIL_; // also links the free list
+        Value value;
+    };
+
+    std::vector<std::unique_ptr<node_[]>> chunks_;
+    std::uint32_t free_;
+    std::uint32_t heads_[WHEEL_LEVELS * WHEEL_SLOTS];
+    // bit per non-empty slot, finds the next due slot without a scan
+    std::uint64_t occupied_[WHEEL_LEVELS][WHEEL_SLOTS / 64];
+    std::uint64_t current_;
+    std::size_t size_;
+
+    node_& node_at_(std::uint32_t index) const {
+        return chunks_[index / WHEEL_NODES_PER_CHUNK][index % WHEEL_NODES_PER_CHUNK];
+    }
+    std::uint32_t allocate_();
+    void release_(std::uint32_t index);
+    void place_(std::uint32_t index);
+    void unlink_(std::uint32_t index);
+    // takes the whole list of a slot out of the wheel
+    std::uint32_t detach_(std::uint32_t slot);
+};
+
+template <typename Value>
+timing_wheel<Value>::timing_wheel()
+        : free_(NIL_),
+          occupied_(),
+          current_(0),
+          size_(0) {
+    for (auto& head : heads_) {
+        head = NIL_;
+    }
+}
+
+template <typename Value>
+std::uint32_t timing_wheel<Value>::allocate_() {
+    if (free_ == NIL_) {
+        std::uint32_t first = static_cast<std::uint32_t>(chunks_.size() * WHEEL_NODES_PER_CHUNK);
+        chunks_.emplace_back(new node_[WHEEL_NODES_PER_CHUNK]);
+        for (std::uint32_t i = WHEEL_NODES_PER_CHUNK; i-- > 0; ) {
+            node_at_(first + i).next = free_;
+            free_ = first + i;
+        }
+    }
+    std::uint32_t index = free_;
+    free_ = node_at_(index).next;
+    return index;
+}
+
+template <typename Value>
+void timing_wheel<Value>::release_(std::uint32_t index) {
+    node_& node = node_at_(index);
+    node.value = Value();
+    node.slot = NIL_;
+    ++node.generation;
+    node.next = free_;
+    free_ = index;
+    --size_;
+}
+
+template <typename Value>
+void timing_wheel<Value>::place_(std::uint32_t index) {
+    node_& node = node_at_(index);
+    // far timers wait at the top level and are placed again when reached
+    const std::uint64_t max_distance = (std::uint64_t(1) << (WHEEL_LEVELS * WHEEL_SLOT_BITS)) - 1;
+    std::uint64_t deadline = node.deadline - current_ > max_distance
+            ? current_ + max_distance : node.deadline;
+    std::uint64_t distance = deadline - current_;
+    std::size_t level = distance < WHEEL_SLOTS ? 0 : (63 - __builtin_clzll(distance)) / WHEEL_SLOT_BITS;
+    std::size_t position = (deadline >> (level * WHEEL_SLOT_BITS)) & (WHEEL_SLOTS - 1);
+
+    std::uint32_t slot = static_cast<std::uint32_t>(level * WHEEL_SLOTS + position);
+    node.slot = slot;
+    node.prev = NIL_;
+    node.next = heads_[slot];
+    if (node.next != NIL_) {
+        node_at_(node.next).prev = index;
+    }
+    heads_[slot] = index;
+    occupied_[level][position / 64] |= std::uint64_t(1) << (position % 64);
+}
+
+template <typename Value>
+void timing_wheel<Value>::unlink_(std::uint32_t index) {
+    node_& node = node_at_(index);
+    if (node.prev != NIL_) {
+        node_at_(node.prev).next = node.next;
+    } else {
+        heads_[node.slot] = node.next;
+    }
+    if (node.next != NIL_) {
+        node_at_(node.next).prev = node.prev;
+    }
+    if (heads_[node.slot] == NIL_) {
+        std::size_t level = node.slot / WHEEL_SLOTS;
+        std::size_t position = node.slot % WHEEL_SLOTS;
+        occupied_[level][position / 64] &= ~(std::uint64_t(1) << (position % 64));
+    }
+}
+
+template <typename Value>
+std::uint32_t timing_wheel<Value>::detach_(std::uint32_t slot) {
+    std::uint32_t head = heads_[slot];
+    heads_[slot] = NIL_;
+    std::size_t position = slot % WHEEL_SLOTS;
+    occupied_[slot / WHEEL_SLOTS][position / 64] &= ~(std::uint64_t(1) << (position % 64));
+    return head;
+}
+
+template <typename Value>
+timer_id timing_wheel<Value>::insert(std::uint64_t deadline, std::uint64_t period, Value value) {
+    std::uint32_t index = allocate_();
+    node_& node = node_at_(index);
+    node.deadline = deadline > current_ ? deadline : current_ + 1;
+    node.period = period;
+    node.value = std::move(value);
+    ++size_;
+    place_(index);
+    return (static_cast<timer_id>(node.generation) << 32) | index;
+}
+
+template <typename Value>
+bool timing_wheel<Value>::cancel(timer_id id) {
+    std::uint32_t index = static_cast<std::uint32_t>(id);
+    if (index >= chunks_.size() * WHEEL_NODES_PER_CHUNK) {
+        return false;
+    }
+    node_& node = node_at_(index);
+    if (node.generation != static_cast<std::uint32_t>(id >> 32) || node.slot == NIL_) {
+        return false;
+    }
+    unlink_(index);
+    release_(index);
+    return true;
+}
+
+template <typename Value>
+std::uint64_t timing_wheel<Value>::next_event() const {
+    // the next occupied slot of the lowest level before it wraps around,
+    // the wrap itself moves timers down from the upper levels
+    std::size_t position = current_ & (WHEEL_SLOTS - 1);
+    for (std::size_t next = position + 1; next < WHEEL_SLOTS; ) {
+        std::uint64_t word = occupied_[0][next / 64] >> (next % 64);
+        if (word != 0) {
+            return next + __builtin_ctzll(word) - position;
+        }
+        next = (next / 64 + 1) * 64;
+    }
+    return WHEEL_SLOTS - position;
+}
+
+template <typename Value>
+template <class Visitor>
+void timing_wheel<Value>::advance(std::uint64_t now, Visitor visitor) {
+    while (current_ < now) {
+        if (size_ == 0) {
+            current_ = now;
+            break;
+        }
+        // ticks without work are skipped
+        std::uint64_t step = next_event();
+        if (now - current_ < step) {
+            current_ = now;
+            break;
+        }
+        current_ += step;
+        // upper levels first: what they move down may be due in this tick
+        for (std::size_t level = WHEEL_LEVELS - 1; level > 0; --level) {
+            std::size_t shift = level * WHEEL_SLOT_BITS;
+            if (current_ & ((std::uint64_t(1) << shift) - 1)) {
+                continue;
+            }
+            std::size_t position = (current_ >> shift) & (WHEEL_SLOTS - 1);
+            std::uint32_t index = detach_(static_cast<std::uint32_t>(level * WHEEL_SLOTS + position));
+            while (index != NIL_) {
+                std::uint32_t next = node_at_(index).next;
+                place_(index);
+                index = next;
+            }
+        }
+        std::uint32_t index = detach_(static_cast<std::uint32_t>(current_ & (WHEEL_SLOTS - 1)));
+        while (index != NIL_) {
+            node_& node = node_at_(index);
+            std::uint32_t next = node.next;
+            if (node.deadline > current_) {
+                place_(index); // a far timer, not due yet
+            } else if (node.period == 0) {
+                visitor(std::move(node.value));
+                release_(index);
+            } else {
+                visitor(Value(node.value));
+                // runs that were missed are skipped, not made up for
+                node.deadline += node.period;
+                if (node.deadline <= current_) {
+                    node.deadline = current_ + 1;
+                }
+                place_(index);
+            }
+            index = next;
+        }
+    }
+}
+
+template <typename Value>
+void timing_wheel<Value>::clear() {
+    for (std::uint32_t slot = 0; slot < WHEEL_LEVELS * WHEEL_SLOTS; ++slot) {
+        std::uint32_t index = detach_(slot);
+        while (index != NIL_) {
+            std::uint32_t next = node_at_(index).next;
+            release_(index);
+            index = next;
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <condition_variable>
 #include <mutex>
+#include "../../task6/spsc_ring_buffer/event_tracer.h"
 
 class barrier {
 public:
@@ -21,6 +22,7 @@ barrier::barrier(size_t num_threads)
 }
 
 void barrier::enter() {
+    TRACE_SCOPE("barrier::enter");
     std::unique_lock<std::mutex> lock(mutex_);
     // wait until the barrier is opened
     closed_barrier_.wait(lock, [this] { return is_barrier_open; });
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Spinning alternatives to barrier with the same enter(). Waiting threads
+// spin for a while and then park on the word they wait for, so that an
+// oversubscribed machine does not burn its cores. A completion callback,
+// if given, runs once per phase before any thread leaves the barrier.
+
+const std::size_t BARRIER_CACHE_LINE_SIZE = 64;
+const std::size_t BARRIER_SPINS = 1024; // polls before parking
+const std::size_t DEFAULT_BARRIER_FAN_IN = 4;
+
+using barrier_completion = std::function<void()>;
+
+// A word to wait on: spins, then parks on it with a futex. Phases are
+// counted with wrap-around, "reached" means not behind the target.
+struct alignas(BARRIER_CACHE_LINE_SIZE) barrier_word {
+    std::atomic<std::uint32_t> value{0};
+    std::atomic<std::uint32_t> sleepers{0};
+
+    bool has_reached(std::uint32_t target) const {
+        return static_cast<std::int32_t>(value.load(std::memory_order_acquire) - target) >= 0;
+    }
+    void wait_until(std::uint32_t target);
+    void publish(std::uint32_t phase);
+};
+
+inline void barrier_word::wait_until(std::uint32_t target) {
+    // no point to spin while the last thread waits for this core
+    static const std::size_t spins = std::thread::hardware_concurrency() > 1 ? BARRIER_SPINS : 0;
+    for (std::size_t i = 0; i < spins; ++i) {
+        if (has_reached(target)) {
+            return;
+        }
+    }
+    while (true) {
+        // registered before the value is read again, see publish()
+        sleepers.fetch_add(1);
+        std::uint32_t current = value.load();
+        if (static_cast<std::int32_t>(current - target) >= 0) {
+            sleepers.fetch_sub(1);
+            return;
+        }
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&value), FUTEX_WAIT_PRIVATE, current,
+                nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+        sleepers.fetch_sub(1);
+    }
+}
+
+inline void barrier_word::publish(std::uint32_t phase) {
+    value.store(phase);
+    if (sleepers.load() > 0) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&value), FUTEX_WAKE_PRIVATE, INT_MAX,
+                nullptr, nullptr, 0);
+#endif
+    }
+}
+
+// Gives every thread that enters a barrier an index below num_threads,
+// the same one each time. The set of threads is fixed: one more distinct
+// thread than num_threads throws std::logic_error.
+class barrier_thread_ids {
+public:
+    explicit barrier_thread_ids(std::size_t num_threads);
+    barrier_thread_ids(const barrier_thread_ids&) = delete;
+    barrier_thread_ids& operator=(const barrier_thread_ids&) = delete;
+    ~barrier_thread_ids();
+    std::size_t id();
+
+private:
+    // serials of the barriers alive, threads drop the ids of the others
+    struct live_serials_ {
+        std::mutex mutex;
+        std::unordered_set<std::uint64_t> serials;
+    };
+
+    std::uint64_t serial_; // unlike the address, never reused by another barrier
+    std::atomic<std::size_t> next_id_;
+    std::size_t num_threads_;
+
+    static live_serials_& live_() {
+        static live_serials_ live;
+        return live;
+    }
+};
+
+inline barrier_thread_ids::barrier_thread_ids(std::size_t num_threads)
+        : next_id_(0),
+          num_threads_(num_threads) {
+    static std::atomic<std::uint64_t> serials(0);
+    serial_ = serials.fetch_add(1);
+    live_serials_& live = live_();
+    std::lock_guard<std::mutex> lock(live.mutex);
+    live.serials.insert(serial_);
+}
+
+inline barrier_thread_ids::~barrier_thread_ids() {
+    live_serials_& live = live_();
+    std::lock_guard<std::mutex> lock(live.mutex);
+    live.serials.erase(serial_);
+}
+
+inline std::size_t barrier_thread_ids::id() {
+    // a thread rarely uses more than a couple of barriers at a time
+    static thread_local std::vector<std::pair<std::uint64_t, std::size_t>> ids;
+    for (const auto& id : ids) {
+        if (id.first == serial_) {
+            return id.second;
+        }
+    }
+    // first entry into this barrier: forget the barriers destroyed since
+    // the last one, so that barriers made per phase do not pile up
+    {
+        live_serials_& live = live_();
+        std::lock_guard<std::mutex> lock(live.mutex);
+        ids.erase(std::remove_if(ids.begin(), ids.end(),
+                                 [&live](const std::pair<std::uint64_t, std::size_t>& id) {
+                                     return live.serials.count(id.first) == 0;
+                                 }),
+                  ids.end());
+    }
+    std::size_t id = next_id_.fetch_add(1);
+    if (id >= num_threads_) {
+        throw std::logic_error("More threads entered the barrier than it was made for.");
+    }
+    ids.emplace_back(serial_, id);
+    return id;
+}
+
+// Centralized barrier: one counter, the last thread to arrive flips the
+// sense (the parity of the phase word) that the others wait for.
+class sense_reversing_barrier {
+public:
+    explicit sense_reversing_barrier(std::size_t num_threads,
+                                     barrier_completion completion = nullptr);
+    void enter();
+
+private:
+    const std::size_t num_threads_;
+    barrier_completion completion_;
+    alignas(BARRIER_CACHE_LINE_SIZE) std::atomic<std::size_t> threads_left_;
+    barrier_word phase_;
+};
+
+inline sense_reversing_barrier::sense_reversing_barrier(std::size_t num_threads,
+                                                        barrier_completion completion)
+        : num_threads_(num_threads),
+          completion_(std::move(completion)),
+          threads_left_(num_threads) {
+    if (num_threads < 1) {
+        throw std::invalid_argument("Number of threads must be positive.");
+    }
+}
+
+inline void sense_reversing_barrier::enter() {
+    std::uint32_t phase = phase_.value.load(std::memory_order_acquire);
+    if (threads_left_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // nobody touches the counter until the phase is published
+        threads_left_.store(num_threads_, std::memory_order_relaxed);
+        if (completion_) {
+            completion_();
+        }
+        phase_.publish(phase + 1);
+    } else {
+        phase_.wait_until(phase + 1);
+    }
+}
+
+// Threads arrive in groups of fan_in at the leaves of a tree, the last of
+// each group goes on to the parent, so no counter sees more than fan_in
+// threads. The last thread at the root releases everybody.
+class combining_tree_barrier {
+public:
+    explicit combining_tree_barrier(std::size_t num_threads,
+                                    barrier_completion completion = nullptr,
+                                    std::size_t fan_in = DEFAULT_BARRIER_FAN_IN);
+    // the same num_threads threads enter every phase, see barrier_thread_ids
+    void enter();
+
+private:
+    struct alignas(BARRIER_CACHE_LINE_SIZE) node_ {
+        std::atomic<std::size_t> threads_left;
+        std::size_t num_children;
+        node_* parent;
+    };
+
+    std::unique_ptr<node_[]> nodes_; // leaves first, the root last
+    std::size_t fan_in_;
+    barrier_completion completion_;
+    barrier_thread_ids ids_;
+    barrier_word phase_;
+};
+
+inline combining_tree_barrier::combining_tree_barrier(std::size_t num_threads,
+                                                      barrier_completion completion,
+                                                      std::size_t fan_in)
+        : fan_in_(fan_in),
+          completion_(std::move(completion)),
+          ids_(num_threads) {
+    if (num_threads < 1) {
+        throw std::invalid_argument("Number of threads must be positive.");
+    }
+    if (fan_in < 2) {
+        throw std::invalid_argument("Fan-in must be at least 2.");
+    }
+    // sizes of the levels from the leaves up
+    std::vector<std::size_t> levels;
+    for (std::size_t width = num_threads; levels.empty() || width > 1; ) {
+        width = (width + fan_in - 1) / fan_in;
+        levels.push_back(width);
+    }
+    std::size_t num_nodes = 0;
+    for (std::size_t width : levels) {
+        num_nodes += width;
+    }
+    nodes_.reset(new node_[num_nodes]);
+    std::size_t first = 0;
+    std::size_t num_children = num_threads; // of the whole level
+    for (std::size_t level = 0; level < levels.size(); ++level) {
+        std::size_t next = first + levels[level];
+        for (std::size_t i = 0; i < levels[level]; ++i) {
+            node_& node = nodes_[first + i];
+            node.num_children = std::min(fan_in, num_children - i * fan_in);
+            node.threads_left.store(node.num_children);
+            node.parent = level + 1 < levels.size() ? &nodes_[next + i / fan_in] : nullptr;
+        }
+        num_children = levels[level];
+        first = next;
+    }
+}
+
+inline void combining_tree_barrier::enter() {
+    std::uint32_t phase = phase_.value.load(std::memory_order_acquire);
+    node_* node = &nodes_[ids_.id() / fan_in_];
+    while (node->threads_left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        node->threads_left.store(node->num_children, std::memory_order_relaxed);
+        if (node->parent == nullptr) {
+            if (completion_) {
+                completion_();
+            }
+            phase_.publish(phase + 1);
+            return;
+        }
+        node = node->parent;
+    }
+    phase_.wait_until(phase + 1);
+}
+
+// In round r thread i signals thread i + 2^r and waits for thread i - 2^r;
+// after ceil(log2(n)) rounds everybody has heard of everybody. No shared
+// counter at all, every flag has one writer and one reader.
+class dissemination_barrier {
+public:
+    explicit dissemination_barrier(std::size_t num_threads,
+                                   barrier_completion completion = nullptr);
+    // the same num_threads threads enter every phase, see barrier_thread_ids
+    void enter();
+
+private:
+    struct alignas(BARRIER_CACHE_LINE_SIZE) thread_ {
+        std::uint32_t phase = 0; // phases this thread has completed
+    };
+
+    const std::size_t num_threads_;
+    std::size_t num_rounds_;
+    std::unique_ptr<barrier_word[]> flags_; // flags_[thread * num_rounds_ + round]
+    std::unique_ptr<thread_[]> threads_;
+    barrier_completion completion_;
+    barrier_thread_ids ids_;
+    barrier_word completed_; // thread 0 publishes the phase once completion_ has run
+};
+
+inline dissemination_barrier::dissemination_barrier(std::size_t num_threads,
+                                                    barrier_completion completion)
+        : num_threads_(num_threads),
+          num_rounds_(0),
+          threads_(new thread_[num_threads]),
+          completion_(std::move(completion)),
+          ids_(num_threads) {
+    if (num_threads < 1) {
+        throw std::invalid_argument("Number of threads must be positive.");
+    }
+    while ((std::size_t(1) << num_rounds_) < num_threads) {
+        ++num_rounds_;
+    }
+    flags_.reset(new barrier_word[num_threads * num_rounds_]);
+}
+
+inline void dissemination_barrier::enter() {
+    std::size_t id = ids_.id();
+    std::uint32_t phase = ++threads_[id].phase;
+    for (std::size_t round = 0; round < num_rounds_; ++round) {
+        std::size_t partner = (id + (std::size_t(1) << round)) % num_threads_;
+        flags_[partner * num_rounds_ + round].publish(phase);
+        flags_[id * num_rounds_ + round].wait_until(phase);
+    }
+    if (!completion_) {
+        return;
+    }
+    if (id == 0) {
+        completion_();
+        completed_.publish(phase);
+    } else {
+        completed_.wait_until(phase);
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+// Counting semaphore that never takes a mutex: acquiring available units
+// is one CAS, releasing one fetch_add. Threads that have to wait park on
+// the counter itself (a futex), releases only make a system call when
+// someone is parked.
+class atomic_semaphore {
+public:
+    explicit atomic_semaphore(int count = 0);
+    atomic_semaphore(const atomic_semaphore&) = delete;
+    atomic_semaphore& operator=(const atomic_semaphore&) = delete;
+
+    void acquire(int units = 1);
+    bool try_acquire(int units = 1);
+    template <class Rep, class Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period>& timeout, int units = 1);
+    void release(int units = 1);
+
+    int available() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int32_t> count_;
+    std::atomic<std::int32_t> waiters_;
+    std::atomic<std::int32_t> bulk_waiters_; // waiters that want more than one unit
+
+    // sleeps while the counter equals expected, at most timeout_ns if not negative
+    void park_(std::int32_t expected, std::int64_t timeout_ns);
+    void wake_(int num_threads);
+    // acquire with an optional deadline, false once it has passed
+    bool acquire_slow_(int units, const std::chrono::steady_clock::time_point* deadline);
+    static void check_units_(int units);
+};
+
+inline atomic_semaphore::atomic_semaphore(int count)
+        : count_(count),
+          waiters_(0),
+          bulk_waiters_(0) {
+    if (count < 0) {
+        throw std::invalid_argument("Initial count must not be negative.");
+    }
+}
+
+inline void atomic_semaphore::check_units_(int units) {
+    if (units < 1) {
+        throw std::invalid_argument("Number of units must be positive.");
+    }
+}
+
+inline bool atomic_semaphore::try_acquire(int units) {
+    check_units_(units);
+    std::int32_t count = count_.load(std::memory_order_relaxed);
+    while (count >= units) {
+        if (count_.compare_exchange_weak(count, count - units, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void atomic_semaphore::acquire(int units) {
+    if (!try_acquire(units)) {
+        acquire_slow_(units, nullptr);
+    }
+}
+
+template <class Rep, class Period>
+bool atomic_semaphore::try_acquire_for(const std::chrono::duration<Rep, Period>& timeout,
+                                       int units) {
+    if (try_acquire(units)) {
+        return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+    return acquire_slow_(units, &deadline);
+}
+
+inline bool atomic_semaphore::acquire_slow_(int units,
+                                            const std::chrono::steady_clock::time_point* deadline) {
+    // registered before the counter is read again, see release()
+    waiters_.fetch_add(1);
+    if (units > 1) {
+        bulk_waiters_.fetch_add(1);
+    }
+    bool acquired = false;
+    while (true) {
+        std::int32_t count = count_.load();
+        if (count >= units) {
+            if (count_.compare_exchange_weak(count, count - units)) {
+                acquired = true;
+                break;
+            }
+            continue;
+        }
+        std::int64_t timeout_ns = -1;
+        if (deadline != nullptr) {
+            timeout_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    *deadline - std::chrono::steady_clock::now()).count();
+            if (timeout_ns <= 0) {
+                break;
+            }
+        }
+        park_(count, timeout_ns);
+    }
+    if (units > 1) {
+        bulk_waiters_.fetch_sub(1);
+    }
+    waiters_.fetch_sub(1);
+    return acquired;
+}
+
+inline void atomic_semaphore::release(int units) {
+    check_units_(units);
+    count_.fetch_add(units);
+    // a waiter registers before it reads the counter, so one of us sees the other
+    if (waiters_.load() > 0) {
+        // a single unit can only serve waiters that want one, larger ones
+        // could take the wake-up and sleep again: wake everybody then
+        wake_(bulk_waiters_.load() > 0 ? INT_MAX : units);
+    }
+}
+
+#ifdef __linux__
+inline void atomic_semaphore::park_(std::int32_t expected, std::int64_t timeout_ns) {
+    timespec timeout;
+    timeout.tv_sec = timeout_ns / 1000000000;
+    timeout.tv_nsec = timeout_ns % 1000000000;
+    // returns at once if the counter has changed meanwhile
+    syscall(SYS_futex, reinterpret_cast<std::int32_t*>(&count_), FUTEX_WAIT_PRIVATE, expected,
+            timeout_ns < 0 ? nullptr : &timeout, nullptr, 0);
+}
+
+inline void atomic_semaphore::wake_(int num_threads) {
+    syscall(SYS_futex, reinterpret_cast<std::int32_t*>(&count_), FUTEX_WAKE_PRIVATE, num_threads,
+            nullptr, nullptr, 0);
+}
+#else
+// without futexes waiters poll
+inline void atomic_semaphore::park_(std::int32_t, std::int64_t) {
+    std::this_thread::yield();
+}
+
+inline void atomic_semaphore::wake_(int) {
+}
+#endif
@@ -13,17 +13,17 @@ private:
     semaphore right_;
 
     int num_steps_;
-    int step_counter_;
 };
 
 robot_sem::robot_sem(int num_steps)
-        : num_steps_(num_steps),
-          step_counter_(0) {
+        : num_steps_(num_steps) {
     right_.signal();
 }
 
 void robot_sem::step(std::string& leg) {
-    while (step_counter_ < num_steps_) {
+    // each leg counts its own steps: a shared counter would race and could
+    // let one leg wait for a partner that has already left
+    for (int step = leg == "left" ? 0 : 1; step < num_steps_; step += 2) {
         if (leg == "left") {
             right_.wait();
             std::cout << "left" << std::endl;
@@ -33,6 +33,5 @@ void robot_sem::step(std::string& leg) {
             std::cout << "right" << std::endl;
             right_.signal();
         }
-        ++step_counter_;
     }
 }
@@ -0,0 +1,83 @@
+// Handoff latency between parties taking strict turns: turn_sequencer with
+// 2..max parties against the two-legged robots. The robots print every
+// step, their output goes to a stream that only counts lines.
+// usage: sequencer_benchmark [steps] [max parties]
+#include "robot_condvar.h"
+#include "robot_sem.h"
+#include "turn_sequencer.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+const std::size_t DEFAULT_STEPS = 200000;
+const std::size_t DEFAULT_MAX_PARTIES = 4;
+
+using clock_type = std::chrono::steady_clock;
+
+class line_counter : public std::streambuf {
+public:
+    std::size_t lines = 0;
+
+protected:
+    int_type overflow(int_type character) override {
+        if (character == '\n') {
+            ++lines;
+        }
+        return character;
+    }
+};
+
+template <typename Robot>
+void bench_robot(const char* name, std::size_t steps) {
+    line_counter counter;
+    std::streambuf* console = std::cout.rdbuf(&counter);
+    Robot robot(steps);
+    auto step = [&robot](std::string leg) {
+        robot.step(leg);
+    };
+    auto start = clock_type::now();
+    std::thread left_leg(step, std::string("left"));
+    std::thread right_leg(step, std::string("right"));
+    left_leg.join();
+    right_leg.join();
+    double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+    std::cout.rdbuf(console);
+    std::cout << name << ",2," << counter.lines << ',' << ns / counter.lines << std::endl;
+}
+
+void bench_sequencer(std::size_t num_parties, std::size_t steps) {
+    turn_sequencer sequencer(num_parties);
+    std::size_t rounds = steps / num_parties;
+    auto start = clock_type::now();
+    std::vector<std::thread> parties;
+    for (std::size_t party = 0; party < num_parties; ++party) {
+        parties.emplace_back([&sequencer, party, rounds] {
+            for (std::size_t i = 0; i < rounds; ++i) {
+                sequencer.wait(party);
+                sequencer.pass(party);
+            }
+        });
+    }
+    for (auto& party : parties) {
+        party.join();
+    }
+    double ns = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+    std::cout << "turn_sequencer," << num_parties << ',' << sequencer.turn() << ','
+              << ns / sequencer.turn() << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::size_t steps = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_STEPS;
+    std::size_t max_parties = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_MAX_PARTIES;
+
+    std::cout << "primitive,parties,handoffs,ns_per_handoff" << std::endl;
+    bench_robot<robot_condvar>("robot_condvar", steps);
+    bench_robot<robot_sem>("robot_sem", steps);
+    for (std::size_t num_parties = 2; num_parties <= max_parties; ++num_parties) {
+        bench_sequencer(num_parties, steps);
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+const std::size_t SEQUENCER_SPINS = 1024; // polls of its slot before a party parks
+
+// Strict round-robin turns for num_parties parties: party 0, 1, ..., n - 1,
+// 0, ... One atomic counter holds the turn, every party waits on a slot
+// of its own, so passing the turn touches and wakes the next party only.
+//
+//     sequencer.wait(party);
+//     ... this party's step ...
+//     sequencer.pass(party);
+class turn_sequencer {
+public:
+    explicit turn_sequencer(std::size_t num_parties);
+    turn_sequencer(const turn_sequencer&) = delete;
+    turn_sequencer& operator=(const turn_sequencer&) = delete;
+
+    void wait(std::size_t party); // until it is the turn of the party
+    void pass(std::size_t party); // the party must hold the turn
+    std::uint64_t turn() const { return turn_.load(std::memory_order_acquire); }
+
+private:
+    struct alignas(64) slot_ {
+        std::atomic<std::uint32_t> granted{0}; // turns given to the party, the futex word
+        std::atomic<std::uint32_t> sleepers{0};
+        std::uint32_t taken = 0; // turns the party has started, its own
+    };
+
+    const std::size_t num_parties_;
+    std::unique_ptr<slot_[]> slots_;
+    alignas(64) std::atomic<std::uint64_t> turn_; // turns passed so far
+};
+
+inline turn_sequencer::turn_sequencer(std::size_t num_parties)
+        : num_parties_(num_parties),
+          slots_(new slot_[num_parties]),
+          turn_(0) {
+    if (num_parties < 1) {
+        throw std::invalid_argument("Number of parties must be positive.");
+    }
+    slots_[0].granted.store(1);
+}
+
+inline void turn_sequencer::wait(std::size_t party) {
+    static const std::size_t spins =
+            std::thread::hardware_concurrency() > 1 ? SEQUENCER_SPINS : 0;
+    slot_& slot = slots_[party];
+    std::uint32_t target = ++slot.taken;
+    for (std::size_t i = 0; i < spins; ++i) {
+        if (slot.granted.load(std::memory_order_acquire) == target) {
+            return;
+        }
+    }
+    while (true) {
+        // registered before granted is read again, see pass()
+        slot.sleepers.fetch_add(1);
+        std::uint32_t granted = slot.granted.load();
+        if (granted == target) {
+            slot.sleepers.fetch_sub(1);
+            return;
+        }
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&slot.granted), FUTEX_WAIT_PRIVATE,
+                granted, nullptr, nullptr, 0);
+#else
+        std::this_thread::yield();
+#endif
+        slot.sleepers.fetch_sub(1);
+    }
+}
+
+inline void turn_sequencer::pass(std::size_t party) {
+    // only the holder moves turn_, so the check cannot race with a pass
+    if (turn_.load(std::memory_order_acquire) % num_parties_ != party % num_parties_) {
+        throw std::logic_error("The party passed a turn it did not hold.");
+    }
+    std::uint64_t turn = turn_.fetch_add(1, std::memory_order_acq_rel) + 1;
+    slot_& next = slots_[turn % num_parties_];
+    next.granted.fetch_add(1);
+    if (next.sleepers.load() > 0) {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&next.granted), FUTEX_WAKE_PRIVATE,
+                INT_MAX, nullptr, nullptr, 0);
+#endif
+    }
+}
@@ -0,0 +1,224 @@
+#include "striped_hash_set.h"
+#include "split_ordered_hash_set.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// usage: benchmark [elements] [threads] [stripes] [blocking|incremental|bloom|stats|distributed|split_ordered]
+const std::size_t DEFAULT_ELEMENTS = 10000000;
+const std::size_t DEFAULT_THREADS = 4;
+const std::size_t DEFAULT_STRIPES = 64;
+const std::size_t BATCH_SIZE = 4096;
+
+// resident memory of the process, counts every allocator alike
+std::size_t resident_bytes() {
+    std::size_t pages = 0;
+    std::size_t resident = 0;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+// bijection on 32-bit keys, spreads consecutive keys over the whole range
+int scramble(std::size_t key) {
+    return static_cast<int>(static_cast<std::uint32_t>(key) * 2654435761u);
+}
+
+// bucket i counts operations that took less than 2^i nanoseconds
+using latency_histogram = std::array<std::atomic<std::size_t>, 64>;
+
+double latency_percentile_us(const latency_histogram& histogram, double percentile) {
+    std::size_t total = 0;
+    for (auto& bucket : histogram) {
+        total += bucket.load();
+    }
+    std::size_t seen = 0;
+    for (std::size_t i = 0; i < histogram.size(); ++i) {
+        seen += histogram[i].load();
+        if (seen >= total * percentile) {
+            return static_cast<double>(std::uint64_t(1) << i) / 1e3;
+        }
+    }
+    return 0;
+}
+
+template <class Function>
+double run_threads(std::size_t num_threads, Function function) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < num_threads; ++i) {
+        threads.emplace_back(function, i);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// lookups through contains_bulk where the engine has it
+template <class Set>
+void contains_batch(Set& set, const std::vector<int>& batch, std::vector<bool>& found) {
+    found.resize(batch.size());
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        found[i] = set.contains(batch[i]);
+    }
+}
+
+template <class T, class H, class Mutex>
+void contains_batch(striped_hash_set<T, H, Mutex>& set, const std::vector<int>& batch,
+                    std::vector<bool>& found) {
+    set.contains_bulk(batch, found);
+}
+
+template <class Set>
+int run(Set& set, std::size_t num_elements, std::size_t num_threads, std::size_t num_stripes) {
+    std::size_t baseline = resident_bytes();
+    std::size_t chunk = num_elements / num_threads;
+
+    // thread i adds even keys of its own range, odd keys are misses
+    latency_histogram add_latency{};
+    double insert = run_threads(num_threads, [&set, &add_latency, chunk](std::size_t i) {
+        for (std::size_t key = i * chunk; key < (i + 1) * chunk; ++key) {
+            auto start = std::chrono::steady_clock::now();
+            set.add(scramble(2 * key));
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+            std::size_t bucket = 0;
+            while (bucket + 1 < add_latency.size() && (std::int64_t(1) << bucket) <= ns) {
+                ++bucket;
+            }
+            add_latency[bucket].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    std::size_t memory = resident_bytes() - baseline;
+
+    std::atomic<std::size_t> found(0);
+    double hit = run_threads(num_threads, [&set, &found, chunk](std::size_t i) {
+        std::size_t local = 0;
+        for (std::size_t key = i * chunk; key < (i + 1) * chunk; ++key) {
+            local += set.contains(scramble(2 * key));
+        }
+        found += local;
+    });
+    double miss = run_threads(num_threads, [&set, &found, chunk](std::size_t i) {
+        std::size_t local = 0;
+        for (std::size_t key = i * chunk; key < (i + 1) * chunk; ++key) {
+            local += set.contains(scramble(2 * key + 1));
+        }
+        found += local;
+    });
+    // same lookups through contains_bulk
+    auto bulk_lookup = [&set, &found, chunk](std::size_t i, std::size_t odd) {
+        std::vector<int> batch;
+        std::vector<bool> batch_found;
+        std::size_t local = 0;
+        for (std::size_t key = i * chunk; key < (i + 1) * chunk; ++key) {
+            batch.push_back(scramble(2 * key + odd));
+            if (batch.size() == BATCH_SIZE || key + 1 == (i + 1) * chunk) {
+                contains_batch(set, batch, batch_found);
+                for (bool current : batch_found) {
+                    local += current;
+                }
+                batch.clear();
+            }
+        }
+        found += local;
+    };
+    double bulk_hit = run_threads(num_threads, [&bulk_lookup](std::size_t i) {
+        bulk_lookup(i, 0);
+    });
+    double bulk_miss = run_threads(num_threads, [&bulk_lookup](std::size_t i) {
+        bulk_lookup(i, 1);
+    });
+    if (found.load() != 2 * chunk * num_threads) {
+        std::cerr << "lookup mismatch: " << found.load() << std::endl;
+        return 1;
+    }
+
+    // 80% lookups, half of them hits, 10% adds, 10% removes
+    double mixed = run_threads(num_threads, [&set, chunk, num_threads](std::size_t i) {
+        std::uint64_t state = i + 1;
+        for (std::size_t op = 0; op < chunk; ++op) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            int key = scramble(state % (2 * chunk * num_threads));
+            std::size_t kind = (state >> 32) % 10;
+            if (kind < 8) {
+                set.contains(key);
+            } else if (kind == 8) {
+                set.add(key);
+            } else {
+                set.remove(key);
+            }
+        }
+    });
+
+    double total = static_cast<double>(chunk * num_threads);
+    std::cout << "elements,threads,stripes,bytes_per_element,insert_mops,hit_mops,miss_mops,"
+              << "bulk_hit_mops,bulk_miss_mops,mixed_mops,add_p99_us,add_p9999_us,add_max_us\n"
+              << chunk * num_threads << ',' << num_threads << ',' << num_stripes << ','
+              << static_cast<double>(memory) / total << ','
+              << total / insert / 1e6 << ',' << total / hit / 1e6 << ','
+              << total / miss / 1e6 << ','
+              << total / bulk_hit / 1e6 << ',' << total / bulk_miss / 1e6 << ','
+              << total / mixed / 1e6 << ','
+              << latency_percentile_us(add_latency, 0.99) << ','
+              << latency_percentile_us(add_latency, 0.9999) << ','
+              << latency_percentile_us(add_latency, 1.0) << std::endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::size_t num_elements = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_ELEMENTS;
+    std::size_t num_threads = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_THREADS;
+    std::size_t num_stripes = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : DEFAULT_STRIPES;
+    std::string engine = argc > 4 ? argv[4] : "blocking";
+
+    if (engine == "split_ordered") {
+        split_ordered_hash_set<int> set;
+        return run(set, num_elements, num_threads, 0);
+    }
+    if (engine == "distributed") {
+        striped_hash_set<int, std::hash<int>, distributed_shared_mutex> set(num_stripes);
+        return run(set, num_elements, num_threads, num_stripes);
+    }
+    resize_policy policy = engine == "incremental"
+            ? resize_policy::incremental : resize_policy::blocking;
+    striped_hash_set<int> set(num_stripes, DEFAULT_GROWTH_FACTOR, DEFAULT_LOAD_FACTOR, policy);
+    if (engine == "stats") {
+        set.enable_statistics();
+        int status = run(set, num_elements, num_threads, num_stripes);
+        std::cout << "stripe,size,capacity,acquisitions,contended,wait_us,rehashes,rehash_us,"
+                     "max_probe_groups,mean_probe_groups\n";
+        std::vector<stripe_statistics> statistics = set.statistics();
+        for (std::size_t index = 0; index < statistics.size(); ++index) {
+            const stripe_statistics& stripe = statistics[index];
+            std::size_t probes = 0;
+            for (std::size_t i = 0; i < stripe.probe_lengths.size(); ++i) {
+                probes += (i + 1) * stripe.probe_lengths[i];
+            }
+            std::cout << index << ',' << stripe.size << ',' << stripe.capacity << ','
+                      << stripe.acquisitions << ',' << stripe.contended_acquisitions << ','
+                      << stripe.wait_ns / 1000 << ',' << stripe.rehashes << ','
+                      << stripe.rehash_ns / 1000 << ',' << stripe.probe_lengths.size() << ','
+                      << (stripe.size ? static_cast<double>(probes) / stripe.size : 0) << '\n';
+        }
+        return status;
+    }
+    if (engine != "bloom") {
+        return run(set, num_elements, num_threads, num_stripes);
+    }
+    set.enable_bloom_filter(num_elements);
+    int status = run(set, num_elements, num_threads, num_stripes);
+    bloom_filter_statistics statistics = set.bloom_statistics();
+    std::cout << "bloom_rejected,bloom_false_positives,bloom_false_positive_rate\n"
+              << statistics.rejected << ',' << statistics.false_positives << ','
+              << statistics.false_positive_rate() << std::endl;
+    return status;
+}
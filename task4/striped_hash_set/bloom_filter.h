@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+const std::size_t BLOOM_BITS_PER_ELEMENT = 12;
+
+// Blocked Bloom filter: all bits of a key live in one 64-byte block, one
+// bit in each of its eight words (split block layout). Safe to use from
+// any number of threads, adding never takes a lock.
+class blocked_bloom_filter {
+public:
+    explicit blocked_bloom_filter(std::size_t expected_elements);
+    blocked_bloom_filter(const blocked_bloom_filter&) = delete;
+    blocked_bloom_filter& operator=(const blocked_bloom_filter&) = delete;
+
+    void add(std::size_t hash);
+    bool may_contain(std::size_t hash) const;
+    void clear();
+    std::size_t capacity() const noexcept { return capacity_; } // elements it was sized for
+
+private:
+    static const std::size_t WORDS_PER_BLOCK = 8;
+
+    struct alignas(64) block_ {
+        std::atomic<std::uint64_t> words[WORDS_PER_BLOCK];
+    };
+
+    std::unique_ptr<block_[]> blocks_;
+    std::size_t num_blocks_;
+    std::size_t capacity_;
+
+    const block_& block_of_(std::size_t hash) const {
+        return blocks_[((hash >> 32) * num_blocks_) >> 32];
+    }
+    static std::uint64_t bit_(std::size_t hash, std::size_t word);
+};
+
+inline blocked_bloom_filter::blocked_bloom_filter(std::size_t expected_elements)
+        : num_blocks_(expected_elements * BLOOM_BITS_PER_ELEMENT / 512 + 1),
+          capacity_(expected_elements) {
+    blocks_.reset(new block_[num_blocks_]);
+    clear();
+}
+
+inline void blocked_bloom_filter::clear() {
+    for (std::size_t i = 0; i < num_blocks_; ++i) {
+        for (auto& word : blocks_[i].words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline std::uint64_t blocked_bloom_filter::bit_(std::size_t hash, std::size_t word) {
+    // odd multipliers from the Parquet split block filter
+    static const std::uint32_t SALT[WORDS_PER_BLOCK] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+    return std::uint64_t(1) << ((static_cast<std::uint32_t>(hash) * SALT[word]) >> 26);
+}
+
+inline void blocked_bloom_filter::add(std::size_t hash) {
+    block_& block = const_cast<block_&>(block_of_(hash));
+    for (std::size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        std::uint64_t bit = bit_(hash, i);
+        // skip the write when the bit is already there to keep the line shared
+        if (!(block.words[i].load(std::memory_order_relaxed) & bit)) {
+            block.words[i].fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+}
+
+inline bool blocked_bloom_filter::may_contain(std::size_t hash) const {
+    const block_& block = block_of_(hash);
+    for (std::size_t i = 0; i < WORDS_PER_BLOCK; ++i) {
+        if (!(block.words[i].load(std::memory_order_relaxed) & bit_(hash, i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct bloom_filter_statistics {
+    std::uint64_t rejected; // lookups answered without taking a lock
+    std::uint64_t false_positives; // passed the filter but were absent
+    std::uint64_t rebuilds;
+
+    double false_positive_rate() const {
+        std::uint64_t negatives = rejected + false_positives;
+        return negatives == 0 ? 0 : static_cast<double>(false_positives) / negatives;
+    }
+};
+
+// Rebuilds the filter of a set every period from a background thread,
+// removed elements keep their bits until then
+template <class Set>
+class bloom_filter_rebuilder {
+public:
+    bloom_filter_rebuilder(Set& set, std::chrono::milliseconds period);
+    bloom_filter_rebuilder(const bloom_filter_rebuilder&) = delete;
+    bloom_filter_rebuilder& operator=(const bloom_filter_rebuilder&) = delete;
+    ~bloom_filter_rebuilder();
+
+private:
+    std::mutex mutex_;
+    std::condition_variable stopped_;
+    bool is_stopped_;
+    std::thread thread_;
+};
+
+template <class Set>
+bloom_filter_rebuilder<Set>::bloom_filter_rebuilder(Set& set, std::chrono::milliseconds period)
+        : is_stopped_(false) {
+    thread_ = std::thread([this, &set, period] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopped_.wait_for(lock, period, [this] { return is_stopped_; })) {
+            lock.unlock();
+            set.rebuild_bloom_filter();
+            lock.lock();
+        }
+    });
+}
+
+template <class Set>
+bloom_filter_rebuilder<Set>::~bloom_filter_rebuilder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        is_stopped_ = true;
+    }
+    stopped_.notify_one();
+    thread_.join();
+}
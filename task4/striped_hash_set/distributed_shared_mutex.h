@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+const std::size_t MAX_READER_SLOTS = 64;
+const std::size_t READER_SPINS = 64; // polls before a reader parks behind the writer
+
+// Reader-writer lock with a reader indicator spread over padded slots,
+// one per hardware thread at most. A reader increments only the slot of
+// its thread, so read-mostly locks do not bounce one cache line between
+// cores; a writer raises a flag and waits for every slot to drain.
+// Writers have priority. Meets the SharedMutex requirements, usable with
+// std::shared_lock and std::unique_lock.
+class distributed_shared_mutex {
+public:
+    distributed_shared_mutex();
+    distributed_shared_mutex(const distributed_shared_mutex&) = delete;
+    distributed_shared_mutex& operator=(const distributed_shared_mutex&) = delete;
+
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+
+private:
+    struct alignas(64) slot_ {
+        std::atomic<std::size_t> readers{0};
+    };
+
+    std::unique_ptr<slot_[]> slots_;
+    std::size_t slot_mask_;
+    std::mutex writer_mutex_; // orders writers, readers park on it
+    alignas(64) std::atomic<bool> is_writing_;
+
+    static std::size_t num_slots_();
+    // fixed per thread, so that unlock_shared() finds the slot of lock_shared()
+    std::atomic<std::size_t>& my_slot_();
+    void wait_for_readers_();
+};
+
+inline std::size_t distributed_shared_mutex::num_slots_() {
+    static const std::size_t num_slots = [] {
+        std::size_t slots = 1;
+        while (slots < std::thread::hardware_concurrency() && slots < MAX_READER_SLOTS) {
+            slots *= 2;
+        }
+        return slots;
+    }();
+    return num_slots;
+}
+
+inline distributed_shared_mutex::distributed_shared_mutex()
+        : slots_(new slot_[num_slots_()]),
+          slot_mask_(num_slots_() - 1),
+          is_writing_(false) {
+}
+
+inline std::atomic<std::size_t>& distributed_shared_mutex::my_slot_() {
+    static std::atomic<std::size_t> next_thread(0);
+    static thread_local std::size_t thread = next_thread.fetch_add(1);
+    return slots_[thread & slot_mask_].readers;
+}
+
+inline void distributed_shared_mutex::lock_shared() {
+    std::atomic<std::size_t>& slot = my_slot_();
+    for (std::size_t spins = 0; ; ++spins) {
+        // seq_cst pairs with the writer: it sees our slot or we see its flag
+        slot.fetch_add(1);
+        if (!is_writing_.load()) {
+            return;
+        }
+        slot.fetch_sub(1);
+        if (spins < READER_SPINS) {
+            std::this_thread::yield();
+        } else {
+            // a writer holds the mutex until it is done
+            std::lock_guard<std::mutex> wait(writer_mutex_);
+        }
+    }
+}
+
+inline bool distributed_shared_mutex::try_lock_shared() {
+    std::atomic<std::size_t>& slot = my_slot_();
+    slot.fetch_add(1);
+    if (!is_writing_.load()) {
+        return true;
+    }
+    slot.fetch_sub(1);
+    return false;
+}
+
+inline void distributed_shared_mutex::unlock_shared() {
+    my_slot_().fetch_sub(1, std::memory_order_release);
+}
+
+inline void distributed_shared_mutex::wait_for_readers_() {
+    // seq_cst like the reader's increment and flag load: with weaker
+    // loads the writer may miss a reader that also misses the flag
+    for (std::size_t i = 0; i <= slot_mask_; ++i) {
+        while (slots_[i].readers.load() != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void distributed_shared_mutex::lock() {
+    writer_mutex_.lock();
+    is_writing_.store(true);
+    wait_for_readers_();
+}
+
+inline bool distributed_shared_mutex::try_lock() {
+    if (!writer_mutex_.try_lock()) {
+        return false;
+    }
+    is_writing_.store(true);
+    for (std::size_t i = 0; i <= slot_mask_; ++i) {
+        if (slots_[i].readers.load() != 0) { // seq_cst, see wait_for_readers_()
+            is_writing_.store(false);
+            writer_mutex_.unlock();
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void distributed_shared_mutex::unlock() {
+    is_writing_.store(false, std::memory_order_release);
+    writer_mutex_.unlock();
+}
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const std::size_t GROUP_SIZE = 16;
+
+// scramble user-provided hash (std::hash<int> is the identity)
+inline std::size_t mix_hash(std::size_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+// Open addressing table with one control byte per slot: empty, deleted or
+// the low 7 bits of the hash with the sign bit set. Control bytes are matched a group of 16 at a
+// time, elements are stored inline. Not synchronized: the owner locks.
+template <typename Value>
+class flat_table {
+public:
+    explicit flat_table(std::size_t capacity = GROUP_SIZE);
+    flat_table(const flat_table&) = delete;
+    flat_table(flat_table&& other) noexcept;
+    flat_table& operator=(const flat_table&) = delete;
+    flat_table& operator=(flat_table&& other) noexcept;
+    ~flat_table();
+
+    // equal(slot) decides whether the slot holds the wanted element
+    template <class Equal>
+    Value* find(std::size_t hash, Equal equal) const;
+    template <class Equal>
+    bool erase(std::size_t hash, Equal equal);
+    // the element must be absent and used() must stay below capacity()
+    template <class... Args>
+    Value* emplace(std::size_t hash, Args&&... args);
+    template <class Visitor>
+    void for_each(Visitor visitor);
+    // pulls the first probed group of the hash into cache
+    void prefetch(std::size_t hash) const;
+    // histogram[i] += number of elements found after probing i + 1 groups
+    template <class HashOf>
+    void probe_lengths(HashOf hash_of, std::vector<std::size_t>& histogram) const;
+    // hands the elements of one group to visitor(Value&&) and removes them
+    template <class Visitor>
+    void extract_group(std::size_t group, Visitor visitor);
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t used() const noexcept { return size_ + deleted_; } // with tombstones
+    std::size_t capacity() const noexcept { return (group_mask_ + 1) * GROUP_SIZE; }
+    std::size_t num_groups() const noexcept { return group_mask_ + 1; }
+    std::size_t memory_usage() const noexcept;
+
+private:
+    // zero is empty so that fresh tables come from calloc without a memset
+    static const std::int8_t EMPTY_ = 0;
+    static const std::int8_t DELETED_ = 1;
+
+    struct alignas(GROUP_SIZE) group_ {
+        std::int8_t control[GROUP_SIZE];
+    };
+    struct free_groups_ {
+        void operator()(group_* groups) const { std::free(groups); }
+    };
+    using slot_ = typename std::aligned_storage<sizeof(Value), alignof(Value)>::type;
+
+    std::unique_ptr<group_[], free_groups_> groups_;
+    std::unique_ptr<slot_[]> slots_;
+    std::size_t group_mask_;
+    std::size_t size_;
+    std::size_t deleted_;
+
+    // bit i is set if control byte i matches
+    static std::uint32_t match_(const group_& group, std::int8_t tag);
+    static std::uint32_t match_empty_or_deleted_(const group_& group);
+    static std::int8_t tag_(std::size_t hash) {
+        return static_cast<std::int8_t>((hash & 0x7F) | 0x80);
+    }
+
+    Value* slot_at_(std::size_t index) const {
+        return reinterpret_cast<Value*>(&slots_[index]);
+    }
+    void destroy_();
+};
+
+template <typename Value>
+flat_table<Value>::flat_table(std::size_t capacity)
+        : size_(0),
+          deleted_(0) {
+    std::size_t num_groups = 1;
+    while (num_groups * GROUP_SIZE < capacity) {
+        num_groups *= 2;
+    }
+    group_mask_ = num_groups - 1;
+    groups_.reset(static_cast<group_*>(std::calloc(num_groups, sizeof(group_))));
+    if (!groups_) {
+        throw std::bad_alloc();
+    }
+    slots_.reset(new slot_[num_groups * GROUP_SIZE]);
+}
+
+template <typename Value>
+flat_table<Value>::flat_table(flat_table&& other) noexcept
+        : groups_(std::move(other.groups_)),
+          slots_(std::move(other.slots_)),
+          group_mask_(other.group_mask_),
+          size_(other.size_),
+          deleted_(other.deleted_) {
+    other.size_ = 0;
+    other.deleted_ = 0;
+}
+
+template <typename Value>
+flat_table<Value>& flat_table<Value>::operator=(flat_table&& other) noexcept {
+    if (this != &other) {
+        destroy_();
+        groups_ = std::move(other.groups_);
+        slots_ = std::move(other.slots_);
+        group_mask_ = other.group_mask_;
+        size_ = other.size_;
+        deleted_ = other.deleted_;
+        other.size_ = 0;
+        other.deleted_ = 0;
+    }
+    return *this;
+}
+
+template <typename Value>
+flat_table<Value>::~flat_table() {
+    destroy_();
+}
+
+template <typename Value>
+void flat_table<Value>::destroy_() {
+    // a drained table is dropped without a scan
+    if (!groups_ || std::is_trivially_destructible<Value>::value || size_ == 0) {
+        return;
+    }
+    for_each([](Value& value) { value.~Value(); });
+}
+
+template <typename Value>
+std::uint32_t flat_table<Value>::match_(const group_& group, std::int8_t tag) {
+#ifdef __SSE2__
+    __m128i control = _mm_load_si128(reinterpret_cast<const __m128i*>(group.control));
+    return static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(tag), control)));
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+        mask |= static_cast<std::uint32_t>(group.control[i] == tag) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename Value>
+std::uint32_t flat_table<Value>::match_empty_or_deleted_(const group_& group) {
+#ifdef __SSE2__
+    // only full slots have the sign bit set
+    __m128i control = _mm_load_si128(reinterpret_cast<const __m128i*>(group.control));
+    return static_cast<std::uint32_t>(~_mm_movemask_epi8(control) & 0xFFFF);
+#else
+    std::uint32_t mask = 0;
+    for (std::size_t i = 0; i < GROUP_SIZE; ++i) {
+        mask |= static_cast<std::uint32_t>(group.control[i] >= 0) << i;
+    }
+    return mask;
+#endif
+}
+
+template <typename Value>
+template <class Equal>
+Value* flat_table<Value>::find(std::size_t hash, Equal equal) const {
+    std::size_t group = (hash >> 7) & group_mask_;
+    // triangular probing visits every group of a power of two table
+    for (std::size_t step = 1; ; ++step) {
+        for (auto mask = match_(groups_[group], tag_(hash)); mask; mask &= mask - 1) {
+            Value* slot = slot_at_(group * GROUP_SIZE + __builtin_ctz(mask));
+            if (equal(*slot)) {
+                return slot;
+            }
+        }
+        if (match_(groups_[group], EMPTY_)) {
+            return nullptr;
+        }
+        group = (group + step) & group_mask_;
+    }
+}
+
+template <typename Value>
+template <class Equal>
+bool flat_table<Value>::erase(std::size_t hash, Equal equal) {
+    Value* slot = find(hash, equal);
+    if (slot == nullptr) {
+        return false;
+    }
+    std::size_t index = slot - slot_at_(0);
+    group_& group = groups_[index / GROUP_SIZE];
+    slot->~Value();
+    --size_;
+    // probing never went past a group with an empty slot, no tombstone needed
+    if (match_(group, EMPTY_)) {
+        group.control[index % GROUP_SIZE] = EMPTY_;
+    } else {
+        group.control[index % GROUP_SIZE] = DELETED_;
+        ++deleted_;
+    }
+    return true;
+}
+
+template <typename Value>
+template <class... Args>
+Value* flat_table<Value>::emplace(std::size_t hash, Args&&... args) {
+    std::size_t group = (hash >> 7) & group_mask_;
+    for (std::size_t step = 1; ; ++step) {
+        auto mask = match_empty_or_deleted_(groups_[group]);
+        if (mask) {
+            std::size_t offset = __builtin_ctz(mask);
+            std::int8_t& control = groups_[group].control[offset];
+            Value* slot = slot_at_(group * GROUP_SIZE + offset);
+            new (slot) Value(std::forward<Args>(args)...);
+            if (control == DELETED_) {
+                --deleted_;
+            }
+            control = tag_(hash);
+            ++size_;
+            return slot;
+        }
+        group = (group + step) & group_mask_;
+    }
+}
+
+template <typename Value>
+template <class Visitor>
+void flat_table<Value>::for_each(Visitor visitor) {
+    for (std::size_t group = 0; group <= group_mask_; ++group) {
+        auto mask = ~match_empty_or_deleted_(groups_[group]) & 0xFFFF;
+        for (; mask; mask &= mask - 1) {
+            visitor(*slot_at_(group * GROUP_SIZE + __builtin_ctz(mask)));
+        }
+    }
+}
+
+template <typename Value>
+void flat_table<Value>::prefetch(std::size_t hash) const {
+    std::size_t group = (hash >> 7) & group_mask_;
+    __builtin_prefetch(&groups_[group]);
+    __builtin_prefetch(slot_at_(group * GROUP_SIZE));
+}
+
+template <typename Value>
+template <class Visitor>
+void flat_table<Value>::extract_group(std::size_t group, Visitor visitor) {
+    auto mask = ~match_empty_or_deleted_(groups_[group]) & 0xFFFF;
+    for (; mask; mask &= mask - 1) {
+        std::size_t offset = __builtin_ctz(mask);
+        Value* slot = slot_at_(group * GROUP_SIZE + offset);
+        visitor(std::move(*slot));
+        slot->~Value();
+        // tombstone keeps later groups reachable for lookups
+        groups_[group].control[offset] = DELETED_;
+        --size_;
+        ++deleted_;
+    }
+}
+
+template <typename Value>
+template <class HashOf>
+void flat_table<Value>::probe_lengths(HashOf hash_of, std::vector<std::size_t>& histogram) const {
+    for (std::size_t group = 0; group <= group_mask_; ++group) {
+        auto mask = ~match_empty_or_deleted_(groups_[group]) & 0xFFFF;
+        for (; mask; mask &= mask - 1) {
+            std::size_t hash = hash_of(*slot_at_(group * GROUP_SIZE + __builtin_ctz(mask)));
+            std::size_t probed = (hash >> 7) & group_mask_;
+            std::size_t length = 1;
+            for (std::size_t step = 1; probed != group; ++step, ++length) {
+                probed = (probed + step) & group_mask_;
+            }
+            if (histogram.size() < length) {
+                histogram.resize(length);
+            }
+            ++histogram[length - 1];
+        }
+    }
+}
+
+template <typename Value>
+std::size_t flat_table<Value>::memory_usage() const noexcept {
+    return (group_mask_ + 1) * sizeof(group_) + capacity() * sizeof(slot_);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+const std::size_t HAZARDS_PER_THREAD = 3;
+const std::size_t RETIRE_THRESHOLD = 64; // retired nodes before a scan
+
+// Process-wide hazard pointers (Michael, 2004). A thread publishes the
+// nodes it is about to dereference in its slots; unlinked nodes are
+// retired and deleted once no slot of any thread points to them.
+class hazard_pointers {
+public:
+    using deleter = void (*)(void*);
+
+    // slots of the calling thread, cleared by the caller when done
+    static std::atomic<void*>* slots();
+    static void retire(void* pointer, deleter destroy);
+
+private:
+    struct record_ {
+        std::atomic<bool> active{true};
+        std::atomic<void*> hazards[HAZARDS_PER_THREAD] = {};
+        record_* next = nullptr;
+        std::vector<std::pair<void*, deleter>> retired; // touched by the owner only
+    };
+    // hands the record back on thread exit, its retired nodes stay there
+    struct owner_ {
+        record_* record;
+        owner_();
+        ~owner_();
+    };
+
+    static std::atomic<record_*>& head_();
+    static record_* acquire_();
+    static record_& local_();
+    static void scan_(record_& record);
+};
+
+inline std::atomic<hazard_pointers::record_*>& hazard_pointers::head_() {
+    static std::atomic<record_*> head(nullptr);
+    return head;
+}
+
+inline hazard_pointers::record_* hazard_pointers::acquire_() {
+    // records are never freed, reuse one released by a finished thread
+    for (record_* record = head_().load(); record != nullptr; record = record->next) {
+        bool active = false;
+        if (!record->active.load(std::memory_order_relaxed) &&
+            record->active.compare_exchange_strong(active, true)) {
+            return record;
+        }
+    }
+    record_* record = new record_();
+    record_* head = head_().load();
+    do {
+        record->next = head;
+    } while (!head_().compare_exchange_weak(head, record));
+    return record;
+}
+
+inline hazard_pointers::owner_::owner_() : record(acquire_()) {
+}
+
+inline hazard_pointers::owner_::~owner_() {
+    for (auto& hazard : record->hazards) {
+        hazard.store(nullptr);
+    }
+    scan_(*record);
+    record->active.store(false);
+}
+
+inline hazard_pointers::record_& hazard_pointers::local_() {
+    static thread_local owner_ owner;
+    return *owner.record;
+}
+
+inline std::atomic<void*>* hazard_pointers::slots() {
+    return local_().hazards;
+}
+
+inline void hazard_pointers::retire(void* pointer, deleter destroy) {
+    record_& record = local_();
+    record.retired.emplace_back(pointer, destroy);
+    if (record.retired.size() >= RETIRE_THRESHOLD) {
+        scan_(record);
+    }
+}
+
+inline void hazard_pointers::scan_(record_& record) {
+    std::unordered_set<void*> protected_pointers;
+    for (record_* other = head_().load(); other != nullptr; other = other->next) {
+        for (auto& hazard : other->hazards) {
+            if (void* pointer = hazard.load()) {
+                protected_pointers.insert(pointer);
+            }
+        }
+    }
+    std::vector<std::pair<void*, deleter>> still_retired;
+    for (auto& retired : record.retired) {
+        if (protected_pointers.count(retired.first)) {
+            still_retired.push_back(retired);
+        } else {
+            retired.second(retired.first);
+        }
+    }
+    record.retired = std::move(still_retired);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Snapshot layout: header, then the element count of every stripe, then
+// the elements as raw bytes, stripe after stripe.
+const char SNAPSHOT_MAGIC[8] = {'S', 'T', 'R', 'I', 'P', 'E', 'D', '1'};
+
+struct snapshot_header {
+    char magic[8];
+    std::uint64_t element_size;
+    std::uint64_t num_stripes;
+};
+
+// Read-only memory mapping of a snapshot file
+class snapshot_file {
+public:
+    explicit snapshot_file(const std::string& path);
+    snapshot_file(const snapshot_file&) = delete;
+    snapshot_file& operator=(const snapshot_file&) = delete;
+    ~snapshot_file();
+
+    const snapshot_header& header() const {
+        return *static_cast<const snapshot_header*>(data_);
+    }
+    const std::uint64_t* stripe_sizes() const {
+        return reinterpret_cast<const std::uint64_t*>(&header() + 1);
+    }
+    const void* elements() const { return stripe_sizes() + header().num_stripes; }
+    std::size_t num_elements() const;
+
+private:
+    void* data_;
+    std::size_t size_;
+};
+
+inline snapshot_file::snapshot_file(const std::string& path) : data_(MAP_FAILED), size_(0) {
+    int descriptor = open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        throw std::runtime_error("Cannot open snapshot " + path);
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 &&
+        static_cast<std::size_t>(status.st_size) >= sizeof(snapshot_header)) {
+        size_ = status.st_size;
+        data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE | MAP_POPULATE, descriptor, 0);
+    }
+    close(descriptor);
+    if (data_ == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot " + path);
+    }
+    std::size_t expected = sizeof(snapshot_header) + header().num_stripes * sizeof(std::uint64_t);
+    if (std::memcmp(header().magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header().num_stripes > size_ / sizeof(std::uint64_t) || size_ < expected ||
+        size_ != expected + num_elements() * header().element_size) {
+        munmap(data_, size_);
+        throw std::runtime_error("Corrupted snapshot " + path);
+    }
+}
+
+inline snapshot_file::~snapshot_file() {
+    munmap(data_, size_);
+}
+
+inline std::size_t snapshot_file::num_elements() const {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < header().num_stripes; ++i) {
+        total += stripe_sizes()[i];
+    }
+    return total;
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "flat_table.h"
+#include "hazard_pointers.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+const float DEFAULT_SPLIT_LOAD_FACTOR = 2; // average nodes per bucket
+const std::size_t MAX_SEGMENTS = 64;
+
+// Lock-free hash set on a split-ordered list (Shalev, Shavit, 2006). All
+// elements live in one lock-free list sorted by bit-reversed hash, buckets
+// are shortcuts into it. Doubling the bucket count never moves elements:
+// new buckets are initialized lazily by splitting their parent's run.
+template <typename T, class H = std::hash<T>>
+class split_ordered_hash_set {
+public:
+    explicit split_ordered_hash_set(float load_factor = DEFAULT_SPLIT_LOAD_FACTOR);
+    split_ordered_hash_set(const split_ordered_hash_set&) = delete;
+    split_ordered_hash_set& operator=(const split_ordered_hash_set&) = delete;
+    ~split_ordered_hash_set();
+
+    void add(const T& element);
+    void remove(const T& element);
+    bool contains(const T& element);
+
+private:
+    // dummy (bucket) nodes have an even key, element nodes an odd one
+    struct node_ {
+        explicit node_(std::size_t split_key) : key(split_key), next(0) {}
+        const std::size_t key;
+        std::atomic<std::uintptr_t> next; // the low bit marks a removed node
+    };
+    struct element_node_ : node_ {
+        element_node_(std::size_t split_key, const T& element)
+                : node_(split_key), value(element) {}
+        T value;
+    };
+    // where an element is or would be linked
+    struct position_ {
+        std::atomic<std::uintptr_t>* prev;
+        node_* current;
+    };
+
+    // segment i holds buckets [2^(i - 1), 2^i), segment 0 holds bucket 0
+    std::atomic<std::atomic<node_*>*> segments_[MAX_SEGMENTS];
+    std::atomic<std::size_t> num_buckets_;
+    std::atomic<std::size_t> num_elements_;
+    float load_factor_;
+
+    H hash_function_;
+
+    static std::size_t reverse_(std::size_t bits);
+    static node_* pointer_(std::uintptr_t link) {
+        return reinterpret_cast<node_*>(link & ~std::uintptr_t(1));
+    }
+    static bool is_marked_(std::uintptr_t link) { return link & 1; }
+    static void delete_node_(void* node);
+
+    std::atomic<node_*>& bucket_slot_(std::size_t bucket);
+    node_* bucket_(std::size_t bucket);
+    node_* initialize_bucket_(std::size_t bucket);
+    // Harris-Michael search from a dummy node; element == nullptr looks for a dummy
+    bool find_(node_* start, std::size_t key, const T* element, position_& position);
+    void clear_hazards_();
+};
+
+template <typename T, class H>
+split_ordered_hash_set<T, H>::split_ordered_hash_set(float load_factor)
+        : num_buckets_(2),
+          num_elements_(0),
+          load_factor_(load_factor) {
+    if (!(load_factor > 0)) {
+        throw std::invalid_argument("Load factor must be positive.");
+    }
+    for (auto& segment : segments_) {
+        segment.store(nullptr);
+    }
+    bucket_slot_(0).store(new node_(0));
+}
+
+template <typename T, class H>
+split_ordered_hash_set<T, H>::~split_ordered_hash_set() {
+    // unlinked nodes belong to hazard_pointers, the rest is still in the list
+    node_* node = bucket_slot_(0).load();
+    while (node != nullptr) {
+        node_* next = pointer_(node->next.load());
+        delete_node_(node);
+        node = next;
+    }
+    for (auto& segment : segments_) {
+        delete[] segment.load();
+    }
+}
+
+template <typename T, class H>
+std::size_t split_ordered_hash_set<T, H>::reverse_(std::size_t bits) {
+    bits = __builtin_bswap64(bits);
+    bits = ((bits & 0x0F0F0F0F0F0F0F0FULL) << 4) | ((bits >> 4) & 0x0F0F0F0F0F0F0F0FULL);
+    bits = ((bits & 0x3333333333333333ULL) << 2) | ((bits >> 2) & 0x3333333333333333ULL);
+    bits = ((bits & 0x5555555555555555ULL) << 1) | ((bits >> 1) & 0x5555555555555555ULL);
+    return bits;
+}
+
+template <typename T, class H>
+void split_ordered_hash_set<T, H>::delete_node_(void* pointer) {
+    node_* node = static_cast<node_*>(pointer);
+    if (node->key & 1) {
+        delete static_cast<element_node_*>(node);
+    } else {
+        delete node;
+    }
+}
+
+template <typename T, class H>
+std::atomic<typename split_ordered_hash_set<T, H>::node_*>&
+split_ordered_hash_set<T, H>::bucket_slot_(std::size_t bucket) {
+    std::size_t segment = bucket == 0 ? 0 : 64 - __builtin_clzll(bucket);
+    std::size_t first = segment == 0 ? 0 : std::size_t(1) << (segment - 1);
+    std::atomic<node_*>* buckets = segments_[segment].load(std::memory_order_acquire);
+    if (buckets == nullptr) {
+        std::size_t size = segment == 0 ? 1 : first;
+        std::atomic<node_*>* fresh = new std::atomic<node_*>[size];
+        for (std::size_t i = 0; i < size; ++i) {
+            fresh[i].store(nullptr, std::memory_order_relaxed);
+        }
+        if (segments_[segment].compare_exchange_strong(buckets, fresh)) {
+            buckets = fresh;
+        } else {
+            delete[] fresh;
+        }
+    }
+    return buckets[bucket - first];
+}
+
+template <typename T, class H>
+typename split_ordered_hash_set<T, H>::node_* split_ordered_hash_set<T, H>::bucket_(
+        std::size_t bucket) {
+    node_* dummy = bucket_slot_(bucket).load(std::memory_order_acquire);
+    return dummy != nullptr ? dummy : initialize_bucket_(bucket);
+}
+
+template <typename T, class H>
+typename split_ordered_hash_set<T, H>::node_*
+split_ordered_hash_set<T, H>::initialize_bucket_(std::size_t bucket) {
+    // the parent's run of the list contains the run of this bucket
+    std::size_t parent = bucket & ~(std::size_t(1) << (63 - __builtin_clzll(bucket)));
+    node_* start = bucket_(parent);
+    node_* dummy = new node_(reverse_(bucket));
+    position_ position;
+    while (true) {
+        if (find_(start, dummy->key, nullptr, position)) {
+            // another thread has linked the dummy first
+            delete dummy;
+            dummy = position.current;
+            break;
+        }
+        dummy->next.store(reinterpret_cast<std::uintptr_t>(position.current));
+        auto expected = reinterpret_cast<std::uintptr_t>(position.current);
+        if (position.prev->compare_exchange_strong(
+                expected, reinterpret_cast<std::uintptr_t>(dummy))) {
+            break;
+        }
+    }
+    clear_hazards_();
+    bucket_slot_(bucket).store(dummy, std::memory_order_release);
+    return dummy;
+}
+
+template <typename T, class H>
+bool split_ordered_hash_set<T, H>::find_(node_* start, std::size_t key, const T* element,
+                                         position_& position) {
+    std::atomic<void*>* hazards = hazard_pointers::slots();
+retry:
+    // dummies are never removed, so the start needs no protection
+    std::atomic<std::uintptr_t>* prev = &start->next;
+    node_* current = pointer_(prev->load());
+    while (true) {
+        hazards[1].store(current);
+        if (pointer_(prev->load()) != current) {
+            goto retry;
+        }
+        if (current == nullptr) {
+            break;
+        }
+        std::uintptr_t next = current->next.load();
+        hazards[0].store(pointer_(next));
+        if (current->next.load() != next) {
+            goto retry;
+        }
+        if (prev->load() != reinterpret_cast<std::uintptr_t>(current)) {
+            goto retry;
+        }
+        if (is_marked_(next)) {
+            // help to unlink a removed node
+            auto expected = reinterpret_cast<std::uintptr_t>(current);
+            if (!prev->compare_exchange_strong(expected, next & ~std::uintptr_t(1))) {
+                goto retry;
+            }
+            hazard_pointers::retire(current, &delete_node_);
+        } else {
+            if (current->key > key) {
+                break;
+            }
+            if (current->key == key && (element == nullptr ||
+                    static_cast<element_node_*>(current)->value == *element)) {
+                position.prev = prev;
+                position.current = current;
+                return true;
+            }
+            prev = &current->next;
+            hazards[2].store(current);
+        }
+        current = pointer_(next);
+    }
+    position.prev = prev;
+    position.current = current;
+    return false;
+}
+
+template <typename T, class H>
+void split_ordered_hash_set<T, H>::clear_hazards_() {
+    std::atomic<void*>* hazards = hazard_pointers::slots();
+    for (std::size_t i = 0; i < HAZARDS_PER_THREAD; ++i) {
+        hazards[i].store(nullptr, std::memory_order_release);
+    }
+}
+
+template <typename T, class H>
+void split_ordered_hash_set<T, H>::add(const T& element) {
+    std::size_t hash = mix_hash(hash_function_(element));
+    std::size_t buckets = num_buckets_.load();
+    node_* start = bucket_(hash & (buckets - 1));
+    std::size_t key = reverse_(hash) | 1;
+    element_node_* node = nullptr;
+    position_ position;
+    while (!find_(start, key, &element, position)) {
+        if (node == nullptr) {
+            node = new element_node_(key, element);
+        }
+        node->next.store(reinterpret_cast<std::uintptr_t>(position.current));
+        auto expected = reinterpret_cast<std::uintptr_t>(position.current);
+        if (position.prev->compare_exchange_strong(
+                expected, reinterpret_cast<std::uintptr_t>(static_cast<node_*>(node)))) {
+            clear_hazards_();
+            // the directory doubles, new buckets are split off when first used
+            if (num_elements_.fetch_add(1) + 1 > buckets * load_factor_) {
+                num_buckets_.compare_exchange_strong(buckets, buckets * 2);
+            }
+            return;
+        }
+    }
+    clear_hazards_();
+    delete node;
+}
+
+template <typename T, class H>
+void split_ordered_hash_set<T, H>::remove(const T& element) {
+    std::size_t hash = mix_hash(hash_function_(element));
+    node_* start = bucket_(hash & (num_buckets_.load() - 1));
+    std::size_t key = reverse_(hash) | 1;
+    position_ position;
+    while (find_(start, key, &element, position)) {
+        std::uintptr_t next = position.current->next.load();
+        if (is_marked_(next)) {
+            continue;
+        }
+        // the mark is the linearization point, unlinking may be left to others
+        if (position.current->next.compare_exchange_strong(next, next | 1)) {
+            num_elements_.fetch_sub(1);
+            auto expected = reinterpret_cast<std::uintptr_t>(position.current);
+            if (position.prev->compare_exchange_strong(expected, next)) {
+                hazard_pointers::retire(position.current, &delete_node_);
+            } else {
+                find_(start, key, &element, position);
+            }
+            break;
+        }
+    }
+    clear_hazards_();
+}
+
+template <typename T, class H>
+bool split_ordered_hash_set<T, H>::contains(const T& element) {
+    std::size_t hash = mix_hash(hash_function_(element));
+    node_* start = bucket_(hash & (num_buckets_.load() - 1));
+    position_ position;
+    bool found = find_(start, reverse_(hash) | 1, &element, position);
+    clear_hazards_();
+    return found;
+}
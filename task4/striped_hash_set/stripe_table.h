@@ -0,0 +1,203 @@
+#pragma once
+
+#include "flat_table.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+const int DEFAULT_GROWTH_FACTOR = 2;
+const float DEFAULT_LOAD_FACTOR = 0.875; // share of occupied slots
+const std::size_t MIGRATION_CHUNK = 8; // groups moved by one incremental step
+
+enum class resize_policy {
+    blocking, // a stripe is rebuilt at once by the add that overflows it
+    incremental // old and new tables coexist, each write moves a few groups
+};
+
+// stripe of a hash: high bits pick the stripe, low bits are left to the table
+inline std::size_t stripe_of(std::size_t hash, std::size_t num_stripes) {
+    return ((hash >> 32) * num_stripes) >> 32;
+}
+
+// constructor arguments of the striped containers
+inline void check_striping(std::size_t num_stripes, int growth_factor, float load_factor) {
+    if (num_stripes < 1) {
+        throw std::invalid_argument("Number of stripes must be positive.");
+    }
+    if (growth_factor < 2) {
+        throw std::invalid_argument("Growth factor must be at least 2.");
+    }
+    if (!(load_factor > 0 && load_factor < 1)) {
+        throw std::invalid_argument("Load factor must be between 0 and 1.");
+    }
+}
+
+// Per-stripe profile of a striped container, see statistics()
+struct stripe_statistics {
+    std::size_t size;
+    std::size_t capacity;
+    std::uint64_t acquisitions; // of the stripe lock, shared or exclusive
+    std::uint64_t contended_acquisitions; // had to wait for the lock
+    std::uint64_t wait_ns;
+    std::uint64_t rehashes;
+    std::uint64_t rehash_ns; // resizes and incremental migration steps
+    // probe_lengths[i]: elements found after probing i + 1 groups of 16 slots
+    std::vector<std::size_t> probe_lengths;
+};
+
+// Storage of one stripe: a flat_table and, during an incremental resize,
+// the previous table that is being drained into it. The owner locks.
+template <typename Value>
+class stripe_table {
+public:
+    stripe_table() : migrated_groups_(0) {}
+
+    // looks into both tables, never migrates: safe under a shared lock
+    template <class Equal>
+    Value* find(std::size_t hash, Equal equal) const;
+    template <class Equal>
+    bool erase(std::size_t hash, Equal equal);
+    // the element must be absent, reserve() has to be called first
+    template <class... Args>
+    Value* emplace(std::size_t hash, Args&&... args);
+    // makes room for one more element, hash_of(value) rehashes moved ones
+    template <class HashOf>
+    void reserve(float load_factor, int growth_factor, resize_policy policy, HashOf hash_of);
+    // makes room for count more elements so that reserve() will not resize
+    template <class HashOf>
+    void presize(std::size_t count, float load_factor, HashOf hash_of);
+    // moves up to num_groups groups of the old table, if there is one
+    template <class HashOf>
+    void migrate(std::size_t num_groups, HashOf hash_of);
+    template <class Visitor>
+    void for_each(Visitor visitor);
+    void prefetch(std::size_t hash) const;
+    template <class HashOf>
+    void probe_lengths(HashOf hash_of, std::vector<std::size_t>& histogram) const;
+
+    std::size_t size() const noexcept;
+    std::size_t capacity() const noexcept { return table_.capacity(); }
+    // reserve() would start a resize
+    bool is_full(float load_factor) const noexcept {
+        return table_.used() + 1 > table_.capacity() * load_factor;
+    }
+    bool is_migrating() const noexcept { return static_cast<bool>(old_table_); }
+
+private:
+    flat_table<Value> table_;
+    std::unique_ptr<flat_table<Value>> old_table_;
+    std::size_t migrated_groups_;
+};
+
+template <typename Value>
+template <class Equal>
+Value* stripe_table<Value>::find(std::size_t hash, Equal equal) const {
+    Value* found = table_.find(hash, equal);
+    if (found == nullptr && old_table_) {
+        found = old_table_->find(hash, equal);
+    }
+    return found;
+}
+
+template <typename Value>
+template <class Equal>
+bool stripe_table<Value>::erase(std::size_t hash, Equal equal) {
+    return table_.erase(hash, equal) || (old_table_ && old_table_->erase(hash, equal));
+}
+
+template <typename Value>
+template <class... Args>
+Value* stripe_table<Value>::emplace(std::size_t hash, Args&&... args) {
+    return table_.emplace(hash, std::forward<Args>(args)...);
+}
+
+template <typename Value>
+template <class HashOf>
+void stripe_table<Value>::reserve(float load_factor, int growth_factor,
+                                  resize_policy policy, HashOf hash_of) {
+    if (!is_full(load_factor)) {
+        return;
+    }
+    // the previous migration has to end before the next one starts
+    migrate(old_table_ ? old_table_->num_groups() : 0, hash_of);
+
+    // mostly tombstones: rebuild with the same capacity instead of growing
+    std::size_t capacity = table_.capacity();
+    if (table_.size() + 1 > capacity * load_factor / 2) {
+        capacity *= growth_factor;
+    }
+    std::unique_ptr<flat_table<Value>> old_table(new flat_table<Value>(capacity));
+    std::swap(*old_table, table_);
+    old_table_ = std::move(old_table);
+    migrated_groups_ = 0;
+    if (policy == resize_policy::blocking) {
+        migrate(old_table_->num_groups(), hash_of);
+    }
+}
+
+template <typename Value>
+template <class HashOf>
+void stripe_table<Value>::presize(std::size_t count, float load_factor, HashOf hash_of) {
+    migrate(old_table_ ? old_table_->num_groups() : 0, hash_of);
+    if (table_.used() + count + 1 <= table_.capacity() * load_factor) {
+        return;
+    }
+    flat_table<Value> table(static_cast<std::size_t>((table_.size() + count + 1) / load_factor) + 1);
+    table_.for_each([&table, &hash_of](Value& current) {
+        std::size_t hash = hash_of(current);
+        table.emplace(hash, std::move(current));
+    });
+    table_ = std::move(table);
+}
+
+template <typename Value>
+template <class HashOf>
+void stripe_table<Value>::migrate(std::size_t num_groups, HashOf hash_of) {
+    if (!old_table_) {
+        return;
+    }
+    std::size_t last = std::min(migrated_groups_ + num_groups, old_table_->num_groups());
+    for (; migrated_groups_ < last; ++migrated_groups_) {
+        old_table_->extract_group(migrated_groups_, [this, &hash_of](Value&& current) {
+            std::size_t hash = hash_of(current);
+            table_.emplace(hash, std::move(current));
+        });
+    }
+    if (migrated_groups_ == old_table_->num_groups()) {
+        old_table_.reset();
+    }
+}
+
+template <typename Value>
+template <class Visitor>
+void stripe_table<Value>::for_each(Visitor visitor) {
+    table_.for_each(visitor);
+    if (old_table_) {
+        old_table_->for_each(visitor);
+    }
+}
+
+template <typename Value>
+void stripe_table<Value>::prefetch(std::size_t hash) const {
+    table_.prefetch(hash);
+    if (old_table_) {
+        old_table_->prefetch(hash);
+    }
+}
+
+template <typename Value>
+template <class HashOf>
+void stripe_table<Value>::probe_lengths(HashOf hash_of, std::vector<std::size_t>& histogram) const {
+    table_.probe_lengths(hash_of, histogram);
+    if (old_table_) {
+        old_table_->probe_lengths(hash_of, histogram);
+    }
+}
+
+template <typename Value>
+std::size_t stripe_table<Value>::size() const noexcept {
+    return table_.size() + (old_table_ ? old_table_->size() : 0);
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "stripe_table.h"
+#include <vector>
+#include <shared_mutex>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+// Key-value counterpart of striped_hash_set. Updates that depend on the
+// current value (upsert, compute_if_absent) run under the stripe lock,
+// so they are atomic with respect to other operations on the same key.
+template <typename K, typename V, class H = std::hash<K>>
+class striped_hash_map {
+public:
+    explicit striped_hash_map(std::size_t num_stripes,
+                              int growth_factor = DEFAULT_GROWTH_FACTOR,
+                              float load_factor = DEFAULT_LOAD_FACTOR,
+                              resize_policy policy = resize_policy::blocking);
+    striped_hash_map(striped_hash_map&) = delete;
+    striped_hash_map(striped_hash_map&&) = default;
+    striped_hash_map& operator=(striped_hash_map&) = delete;
+    striped_hash_map& operator=(striped_hash_map&&) = default;
+    ~striped_hash_map() = default;
+
+    bool find(const K& key, V& value); // copies the value if the key is present
+    template <class Visitor>
+    bool visit(const K& key, Visitor visitor); // visitor(const V&) under shared lock
+    bool insert_or_assign(const K& key, V value); // true if the key was absent
+    bool erase(const K& key);
+    // applies function(V&) to the value, value-initialized if the key is absent
+    template <class Function>
+    V upsert(const K& key, Function function);
+    // inserts factory() if the key is absent, returns the stored value
+    template <class Factory>
+    V compute_if_absent(const K& key, Factory factory);
+
+private:
+    using entry_ = std::pair<K, V>;
+
+    std::vector<stripe_table<entry_>> hash_table_; // one table per stripe
+    std::vector<std::shared_timed_mutex> mutex_array_;
+    float load_factor_;
+    int growth_factor_;
+    resize_policy policy_;
+
+    H hash_function_;
+    std::size_t hash_(const K& key) const;
+    std::size_t stripe_(std::size_t hash) const;
+    // finds the entry of the key or inserts make_value() for it
+    template <class MakeValue>
+    entry_* find_or_insert_(stripe_table<entry_>& stripe, std::size_t hash,
+                            const K& key, MakeValue make_value);
+};
+
+template <typename K, typename V, class H>
+striped_hash_map<K, V, H>::striped_hash_map(std::size_t num_stripes,
+                                            int growth_factor,
+                                            float load_factor,
+                                            resize_policy policy)
+        : hash_table_(num_stripes),
+          mutex_array_(num_stripes),
+          load_factor_(load_factor),
+          growth_factor_(growth_factor),
+          policy_(policy) {
+    check_striping(num_stripes, growth_factor, load_factor);
+}
+
+template <typename K, typename V, class H>
+std::size_t striped_hash_map<K, V, H>::hash_(const K& key) const {
+    return mix_hash(hash_function_(key));
+}
+
+template <typename K, typename V, class H>
+std::size_t striped_hash_map<K, V, H>::stripe_(std::size_t hash) const {
+    return stripe_of(hash, mutex_array_.size());
+}
+
+template <typename K, typename V, class H>
+template <class MakeValue>
+typename striped_hash_map<K, V, H>::entry_* striped_hash_map<K, V, H>::find_or_insert_(
+        stripe_table<entry_>& stripe, std::size_t hash, const K& key, MakeValue make_value) {
+    auto hash_of = [this](const entry_& current) { return hash_(current.first); };
+    stripe.migrate(MIGRATION_CHUNK, hash_of);
+    entry_* entry = stripe.find(hash, [&key](const entry_& current) {
+        return current.first == key;
+    });
+    if (entry == nullptr) {
+        stripe.reserve(load_factor_, growth_factor_, policy_, hash_of);
+        entry = stripe.emplace(hash, key, make_value());
+    }
+    return entry;
+}
+
+template <typename K, typename V, class H>
+bool striped_hash_map<K, V, H>::find(const K& key, V& value) {
+    return visit(key, [&value](const V& current) { value = current; });
+}
+
+template <typename K, typename V, class H>
+template <class Visitor>
+bool striped_hash_map<K, V, H>::visit(const K& key, Visitor visitor) {
+    std::size_t hash = hash_(key);
+    std::size_t index = stripe_(hash);
+    std::shared_lock<std::shared_timed_mutex> lock(mutex_array_[index]);
+    const entry_* entry = hash_table_[index].find(hash, [&key](const entry_& current) {
+        return current.first == key;
+    });
+    if (entry == nullptr) {
+        return false;
+    }
+    visitor(entry->second);
+    return true;
+}
+
+template <typename K, typename V, class H>
+bool striped_hash_map<K, V, H>::insert_or_assign(const K& key, V value) {
+    std::size_t hash = hash_(key);
+    std::size_t index = stripe_(hash);
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_array_[index]);
+    bool inserted = false;
+    entry_* entry = find_or_insert_(hash_table_[index], hash, key, [&value, &inserted] {
+        inserted = true;
+        return std::move(value);
+    });
+    if (!inserted) {
+        entry->second = std::move(value);
+    }
+    return inserted;
+}
+
+template <typename K, typename V, class H>
+bool striped_hash_map<K, V, H>::erase(const K& key) {
+    std::size_t hash = hash_(key);
+    std::size_t index = stripe_(hash);
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_array_[index]);
+
+    stripe_table<entry_>& stripe = hash_table_[index];
+    stripe.migrate(MIGRATION_CHUNK, [this](const entry_& current) {
+        return hash_(current.first);
+    });
+    return stripe.erase(hash, [&key](const entry_& current) {
+        return current.first == key;
+    });
+}
+
+template <typename K, typename V, class H>
+template <class Function>
+V striped_hash_map<K, V, H>::upsert(const K& key, Function function) {
+    std::size_t hash = hash_(key);
+    std::size_t index = stripe_(hash);
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_array_[index]);
+    entry_* entry = find_or_insert_(hash_table_[index], hash, key, [] { return V(); });
+    function(entry->second);
+    return entry->second;
+}
+
+template <typename K, typename V, class H>
+template <class Factory>
+V striped_hash_map<K, V, H>::compute_if_absent(const K& key, Factory factory) {
+    std::size_t hash = hash_(key);
+    std::size_t index = stripe_(hash);
+    std::unique_lock<std::shared_timed_mutex> lock(mutex_array_[index]);
+    return find_or_insert_(hash_table_[index], hash, key, factory)->second;
+}
@@ -1,20 +1,30 @@
+#include "stripe_table.h"
+#include "snapshot.h"
+#include "bloom_filter.h"
+#include "distributed_shared_mutex.h"
 #include <iostream>
 #include <vector>
-#include <forward_list>
 #include <shared_mutex>
+#include <mutex>
 #include <atomic>
-#include <iostream>
 #include <stdexcept>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <type_traits>
 
-const int DEFAULT_GROWTH_FACTOR = 2;
-const float DEFAULT_LOAD_FACTOR = 1.5;
+const std::size_t PREFETCH_DISTANCE = 8; // keys prefetched ahead in bulk operations
 
-template <typename T, class H = std::hash<T>>
+// Mutex guards one stripe: std::shared_timed_mutex, or a SharedMutex such
+// as distributed_shared_mutex for read-mostly sets
+template <typename T, class H = std::hash<T>, class Mutex = std::shared_timed_mutex>
 class striped_hash_set {
 public:
     explicit striped_hash_set(std::size_t num_stripes,
                               int growth_factor = DEFAULT_GROWTH_FACTOR,
-                              float load_factor = DEFAULT_LOAD_FACTOR);
+                              float load_factor = DEFAULT_LOAD_FACTOR,
+                              resize_policy policy = resize_policy::blocking);
     striped_hash_set(striped_hash_set&) = delete;
     striped_hash_set(striped_hash_set&&) = default;
     striped_hash_set& operator=(striped_hash_set&) = delete;
@@ -25,107 +35,502 @@ public:
     void remove(const T& element);
     bool contains(const T& element);
 
+    // each stripe is locked once per batch, found[i] tells about elements[i]
+    void add_bulk(const std::vector<T>& elements);
+    void remove_bulk(const std::vector<T>& elements);
+    void contains_bulk(const std::vector<T>& elements, std::vector<bool>& found);
+
+    // binary snapshot for trivially copyable T, consistent per stripe:
+    // stripes are copied one at a time under their shared lock
+    void save(const std::string& path);
+    // adds the elements of a snapshot, presizing every stripe once and
+    // filling disjoint groups of stripes from num_threads threads
+    void load(const std::string& path,
+              std::size_t num_threads = std::thread::hardware_concurrency());
+
+    // puts a Bloom filter sized for expected_elements in front of contains(),
+    // so that most misses take no lock; call before the set is shared
+    void enable_bloom_filter(std::size_t expected_elements);
+    // drops the bits of removed elements, see bloom_filter_rebuilder
+    void rebuild_bloom_filter();
+    bloom_filter_statistics bloom_statistics() const;
+
+    // starts counting lock contention and rehashes per stripe; call before
+    // the set is shared, costs nothing while off
+    void enable_statistics();
+    // one entry per stripe, probe lengths are counted on the spot
+    std::vector<stripe_statistics> statistics();
+
 private:
-    std::vector<std::forward_list<T>> hash_table_;
-    std::vector<std::shared_timed_mutex> mutex_array_;
+    using exclusive_lock_ = std::unique_lock<Mutex>;
+    using shared_lock_ = std::shared_lock<Mutex>;
+
+    std::vector<stripe_table<T>> hash_table_; // one table per stripe
+    std::vector<Mutex> mutex_array_;
     float load_factor_;
     int growth_factor_;
-    std::atomic<int> num_elements_;
-    std::atomic<std::size_t> hash_table_size_;
+    resize_policy policy_;
 
     H hash_function_;
-    void rehash();
-    void push(const T& element, int hash);
+    std::size_t hash_(const T& element) const;
+    std::size_t stripe_(std::size_t hash) const;
+    // adds the element to a stripe locked by the caller
+    void insert_(std::size_t index, std::size_t hash, const T& element);
+    // moves a chunk of an incremental resize of a stripe locked by the caller
+    void migrate_(std::size_t index);
+
+    struct alignas(64) stripe_counters_ {
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contended_acquisitions{0};
+        std::atomic<std::uint64_t> wait_ns{0};
+        std::atomic<std::uint64_t> rehashes{0}; // written under the stripe lock
+        std::atomic<std::uint64_t> rehash_ns{0};
+    };
+    std::unique_ptr<stripe_counters_[]> counters_; // null unless enabled
+
+    // Lock is exclusive_lock_ or shared_lock_
+    template <class Lock>
+    Lock lock_(std::size_t index);
+
+    struct alignas(64) bloom_counters_ {
+        std::atomic<std::uint64_t> rejected{0};
+        std::atomic<std::uint64_t> false_positives{0};
+    };
+    // Rebuilds fill a spare filter and swap it in. Lock-free readers check
+    // the sequence, as in a seqlock, to ignore bits read during a swap or
+    // from a filter that is being cleared for reuse. Filters outgrown by
+    // the set are kept until destruction, readers may still look at them.
+    struct bloom_front_ {
+        bloom_front_(std::size_t num_stripes, std::size_t expected_elements);
+
+        std::vector<std::unique_ptr<blocked_bloom_filter>> filters; // the last two are live
+        std::atomic<blocked_bloom_filter*> filter;
+        std::atomic<blocked_bloom_filter*> next_filter; // filled by a running rebuild
+        blocked_bloom_filter* spare;
+        std::atomic<std::uint64_t> sequence; // odd during a swap
+        std::atomic<std::uint64_t> rebuilds;
+        std::unique_ptr<bloom_counters_[]> counters; // one per stripe
+        std::mutex rebuild_mutex;
+    };
+    std::unique_ptr<bloom_front_> bloom_; // null unless enabled
+
+    struct batch_ {
+        std::vector<std::size_t> hashes;
+        std::vector<std::size_t> order; // element indices sorted by stripe
+        std::vector<std::size_t> offsets; // stripe i owns order[offsets[i]..offsets[i + 1])
+    };
+    batch_ group_by_stripe_(const T* elements, std::size_t num_elements) const;
+    // calls visit(stripe index, element index, hash) for the batch, stripe by stripe
+    template <class Lock, class Visit>
+    void for_each_in_batch_(const std::vector<T>& elements, Visit visit);
 };
 
-template <typename T, class H>
-striped_hash_set<T, H>::striped_hash_set(std::size_t num_stripes,
+template <typename T, class H, class Mutex>
+striped_hash_set<T, H, Mutex>::striped_hash_set(std::size_t num_stripes,
                                          int growth_factor,
-                                         float load_factor)
+                                         float load_factor,
+                                         resize_policy policy)
         : hash_table_(num_stripes),
           mutex_array_(num_stripes),
           load_factor_(load_factor),
           growth_factor_(growth_factor),
-          num_elements_(0),
-          hash_table_size_(num_stripes) {
-    if (num_stripes < 1) {
-        throw std::invalid_argument("Number of stripes must be positive.");
+          policy_(policy) {
+    check_striping(num_stripes, growth_factor, load_factor);
+}
+
+template <typename T, class H, class Mutex>
+std::size_t striped_hash_set<T, H, Mutex>::hash_(const T& element) const {
+    return mix_hash(hash_function_(element));
+}
+
+template <typename T, class H, class Mutex>
+std::size_t striped_hash_set<T, H, Mutex>::stripe_(std::size_t hash) const {
+    return stripe_of(hash, mutex_array_.size());
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::add(const T& element) {
+    std::size_t hash = hash_(element);
+    std::size_t index = stripe_(hash);
+    exclusive_lock_ lock = lock_<exclusive_lock_>(index);
+
+    migrate_(index);
+    insert_(index, hash, element);
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::insert_(std::size_t index, std::size_t hash, const T& element) {
+    stripe_table<T>& stripe = hash_table_[index];
+    if (stripe.find(hash, [&element](const T& current) { return current == element; })) {
+        return;
+    }
+    // only this stripe is rebuilt, the others stay available
+    auto hash_of = [this](const T& current) { return hash_(current); };
+    if (counters_ && stripe.is_full(load_factor_)) {
+        auto start = std::chrono::steady_clock::now();
+        stripe.reserve(load_factor_, growth_factor_, policy_, hash_of);
+        counters_[index].rehashes.fetch_add(1, std::memory_order_relaxed);
+        counters_[index].rehash_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    } else {
+        stripe.reserve(load_factor_, growth_factor_, policy_, hash_of);
+    }
+    stripe.emplace(hash, element);
+    if (bloom_) {
+        // a rebuild past this stripe must see the element in its new filter
+        if (blocked_bloom_filter* next = bloom_->next_filter.load()) {
+            next->add(hash);
+        }
+        bloom_->filter.load()->add(hash);
+    }
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::migrate_(std::size_t index) {
+    stripe_table<T>& stripe = hash_table_[index];
+    auto hash_of = [this](const T& current) { return hash_(current); };
+    if (counters_ && stripe.is_migrating()) {
+        auto start = std::chrono::steady_clock::now();
+        stripe.migrate(MIGRATION_CHUNK, hash_of);
+        counters_[index].rehash_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    } else {
+        stripe.migrate(MIGRATION_CHUNK, hash_of);
+    }
+}
+
+template <typename T, class H, class Mutex>
+template <class Lock>
+Lock striped_hash_set<T, H, Mutex>::lock_(std::size_t index) {
+    if (!counters_) {
+        return Lock(mutex_array_[index]);
+    }
+    Lock lock(mutex_array_[index], std::try_to_lock);
+    if (!lock.owns_lock()) {
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        counters_[index].contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+        counters_[index].wait_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
     }
+    counters_[index].acquisitions.fetch_add(1, std::memory_order_relaxed);
+    return lock;
 }
 
-template <typename T, class H>
-void striped_hash_set<T, H>::push(const T& element, int hash) {
-    for (auto current : hash_table_[hash % hash_table_size_.load()]) {
-        if (current == element) {
-            return;
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::remove(const T& element) {
+    std::size_t hash = hash_(element);
+    std::size_t index = stripe_(hash);
+    exclusive_lock_ lock = lock_<exclusive_lock_>(index);
+
+    migrate_(index);
+    hash_table_[index].erase(hash, [&element](const T& current) { return current == element; });
+}
+
+template <typename T, class H, class Mutex>
+bool striped_hash_set<T, H, Mutex>::contains(const T& element) {
+    std::size_t hash = hash_(element);
+    std::size_t index = stripe_(hash);
+    if (bloom_) {
+        std::uint64_t sequence = bloom_->sequence.load(std::memory_order_acquire);
+        bool may_contain = sequence % 2 == 1 ||
+                           bloom_->filter.load(std::memory_order_acquire)->may_contain(hash);
+        // the filter may have been swapped or cleared meanwhile, then ask the table
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!may_contain && bloom_->sequence.load(std::memory_order_relaxed) == sequence) {
+            bloom_->counters[index].rejected.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
     }
-    hash_table_[hash % hash_table_size_.load()].push_front(element);
-    num_elements_.store(num_elements_ + 1);
+    shared_lock_ lock = lock_<shared_lock_>(index);
+    bool found = hash_table_[index].find(hash, [&element](const T& current) {
+        return current == element;
+    }) != nullptr;
+    if (bloom_ && !found) {
+        bloom_->counters[index].false_positives.fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
 }
 
-template <typename T, class H>
-void striped_hash_set<T, H>::add(const T& element) {
-    std::vector<std::unique_lock<std::shared_timed_mutex>> lock_array;
+template <typename T, class H, class Mutex>
+typename striped_hash_set<T, H, Mutex>::batch_ striped_hash_set<T, H, Mutex>::group_by_stripe_(
+        const T* elements, std::size_t num_elements) const {
+    batch_ batch;
+    batch.hashes.resize(num_elements);
+    batch.order.resize(num_elements);
+    batch.offsets.assign(mutex_array_.size() + 1, 0);
+    // counting sort by stripe
+    for (std::size_t i = 0; i < num_elements; ++i) {
+        batch.hashes[i] = hash_(elements[i]);
+        ++batch.offsets[stripe_(batch.hashes[i]) + 1];
+    }
+    for (std::size_t i = 1; i < batch.offsets.size(); ++i) {
+        batch.offsets[i] += batch.offsets[i - 1];
+    }
+    std::vector<std::size_t> position(batch.offsets.begin(), batch.offsets.end() - 1);
+    for (std::size_t i = 0; i < num_elements; ++i) {
+        batch.order[position[stripe_(batch.hashes[i])]++] = i;
+    }
+    return batch;
+}
 
-    lock_array.emplace_back(mutex_array_[0]);
+template <typename T, class H, class Mutex>
+template <class Lock, class Visit>
+void striped_hash_set<T, H, Mutex>::for_each_in_batch_(const std::vector<T>& elements, Visit visit) {
+    batch_ batch = group_by_stripe_(elements.data(), elements.size());
+    for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+        std::size_t first = batch.offsets[index];
+        std::size_t last = batch.offsets[index + 1];
+        if (first == last) {
+            continue;
+        }
+        Lock lock = lock_<Lock>(index);
+        stripe_table<T>& stripe = hash_table_[index];
+        for (std::size_t i = first; i < std::min(first + PREFETCH_DISTANCE, last); ++i) {
+            stripe.prefetch(batch.hashes[batch.order[i]]);
+        }
+        for (std::size_t i = first; i < last; ++i) {
+            if (i + PREFETCH_DISTANCE < last) {
+                stripe.prefetch(batch.hashes[batch.order[i + PREFETCH_DISTANCE]]);
+            }
+            visit(index, batch.order[i], batch.hashes[batch.order[i]]);
+        }
+    }
+}
 
-    // insert without rehash
-    int hash = hash_function_(element);
-    if (num_elements_.load() / hash_table_size_.load() < load_factor_) {
-        mutex_array_[0].unlock();
-        std::unique_lock<std::shared_timed_mutex> lock(
-                mutex_array_[hash % mutex_array_.size()]);
-        push(element, hash);
-        return;
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::add_bulk(const std::vector<T>& elements) {
+    for_each_in_batch_<exclusive_lock_>(elements,
+            [this, &elements](std::size_t index, std::size_t i, std::size_t hash) {
+        migrate_(index);
+        insert_(index, hash, elements[i]);
+    });
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::remove_bulk(const std::vector<T>& elements) {
+    for_each_in_batch_<exclusive_lock_>(elements,
+            [this, &elements](std::size_t index, std::size_t i, std::size_t hash) {
+        const T& element = elements[i];
+        migrate_(index);
+        hash_table_[index].erase(hash, [&element](const T& current) { return current == element; });
+    });
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::contains_bulk(const std::vector<T>& elements,
+                                           std::vector<bool>& found) {
+    found.assign(elements.size(), false);
+    for_each_in_batch_<shared_lock_>(elements,
+            [this, &elements, &found](std::size_t index, std::size_t i, std::size_t hash) {
+        const T& element = elements[i];
+        found[i] = hash_table_[index].find(hash, [&element](const T& current) {
+            return current == element;
+        }) != nullptr;
+    });
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::save(const std::string& path) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Snapshots store elements as raw bytes.");
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    snapshot_header header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.element_size = sizeof(T);
+    header.num_stripes = mutex_array_.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // sizes are known only after copying, their place is filled in at the end
+    std::vector<std::uint64_t> stripe_sizes(mutex_array_.size());
+    file.write(reinterpret_cast<const char*>(stripe_sizes.data()),
+               stripe_sizes.size() * sizeof(std::uint64_t));
+    std::vector<T> buffer;
+    for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+        buffer.clear();
+        {
+            shared_lock_ lock = lock_<shared_lock_>(index);
+            hash_table_[index].for_each([&buffer](const T& current) {
+                buffer.push_back(current);
+            });
+        }
+        stripe_sizes[index] = buffer.size();
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(T));
+    }
+    file.seekp(sizeof(header));
+    file.write(reinterpret_cast<const char*>(stripe_sizes.data()),
+               stripe_sizes.size() * sizeof(std::uint64_t));
+    file.flush();
+    if (!file) {
+        throw std::runtime_error("Cannot write snapshot " + path);
+    }
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::load(const std::string& path, std::size_t num_threads) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Snapshots store elements as raw bytes.");
+    snapshot_file snapshot(path);
+    if (snapshot.header().element_size != sizeof(T)) {
+        throw std::invalid_argument("Snapshot holds elements of another type.");
+    }
+    num_threads = std::max<std::size_t>(1, std::min(num_threads, mutex_array_.size()));
+    const T* elements = static_cast<const T*>(snapshot.elements());
+    std::size_t num_elements = snapshot.num_elements();
+    // the same striping puts every stripe of the file into one of ours
+    bool same_stripes = snapshot.header().num_stripes == mutex_array_.size();
+    // otherwise elements are hashed and sorted by stripe once, up front
+    batch_ batch;
+    if (!same_stripes) {
+        batch = group_by_stripe_(elements, num_elements);
     }
 
-    // check load factor once again to prevent from data race
-    std::atomic<std::size_t> hash_table_size;
-    hash_table_size.store(hash_table_size_.load());
-    if (hash_table_size_.load() != hash_table_size.load()) {
-        return;
+    auto hash_of = [this](const T& current) { return hash_(current); };
+    std::vector<std::size_t> misplaced; // written under misplaced_mutex
+    std::mutex misplaced_mutex;
+    auto build = [&](std::size_t thread) {
+        // thread owns stripes thread, thread + num_threads, ... and locks them once
+        std::vector<exclusive_lock_> locks;
+        for (std::size_t index = thread; index < mutex_array_.size(); index += num_threads) {
+            locks.push_back(lock_<exclusive_lock_>(index));
+        }
+        std::vector<std::size_t> local_misplaced;
+        std::size_t first = 0;
+        for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+            std::size_t last = first + (same_stripes ? snapshot.stripe_sizes()[index] : 0);
+            if (index % num_threads == thread) {
+                stripe_table<T>& stripe = hash_table_[index];
+                if (same_stripes) {
+                    stripe.presize(last - first, load_factor_, hash_of);
+                    // a different hash function may send elements elsewhere
+                    for (std::size_t i = first; i < last; ++i) {
+                        std::size_t hash = hash_(elements[i]);
+                        if (stripe_(hash) == index) {
+                            insert_(index, hash, elements[i]);
+                        } else {
+                            local_misplaced.push_back(i);
+                        }
+                    }
+                } else {
+                    stripe.presize(batch.offsets[index + 1] - batch.offsets[index],
+                                   load_factor_, hash_of);
+                    for (std::size_t i = batch.offsets[index]; i < batch.offsets[index + 1]; ++i) {
+                        std::size_t element = batch.order[i];
+                        insert_(index, batch.hashes[element], elements[element]);
+                    }
+                }
+            }
+            first = last;
+        }
+        std::lock_guard<std::mutex> lock(misplaced_mutex);
+        misplaced.insert(misplaced.end(), local_misplaced.begin(), local_misplaced.end());
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t thread = 1; thread < num_threads; ++thread) {
+        threads.emplace_back(build, thread);
+    }
+    build(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (std::size_t i : misplaced) {
+        add(elements[i]);
+    }
+}
+
+template <typename T, class H, class Mutex>
+striped_hash_set<T, H, Mutex>::bloom_front_::bloom_front_(std::size_t num_stripes,
+                                                   std::size_t expected_elements)
+        : next_filter(nullptr),
+          sequence(0),
+          rebuilds(0),
+          counters(new bloom_counters_[num_stripes]) {
+    for (int i = 0; i < 2; ++i) {
+        filters.emplace_back(new blocked_bloom_filter(expected_elements));
     }
+    filter.store(filters[0].get());
+    spare = filters[1].get();
+}
+
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::enable_bloom_filter(std::size_t expected_elements) {
+    bloom_.reset(new bloom_front_(mutex_array_.size(), expected_elements));
+    rebuild_bloom_filter();
+}
 
-    // lock the rest of mutexes
-    for (std::size_t i = 1; i < mutex_array_.size(); ++i) {
-        lock_array.emplace_back(mutex_array_[i]);
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::rebuild_bloom_filter() {
+    if (!bloom_) {
+        return;
+    }
+    std::lock_guard<std::mutex> rebuild_lock(bloom_->rebuild_mutex);
+    std::size_t size = 0;
+    for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+        shared_lock_ lock = lock_<shared_lock_>(index);
+        size += hash_table_[index].size();
+    }
+    blocked_bloom_filter* next = bloom_->spare;
+    if (next->capacity() < size + size / 4) {
+        bloom_->filters.emplace_back(new blocked_bloom_filter(2 * size));
+        next = bloom_->filters.back().get();
+    } else {
+        // readers still looking at the old bits must see the swap that retired them
+        std::atomic_thread_fence(std::memory_order_release);
+        next->clear();
+    }
+    // adds from now on go to both filters
+    bloom_->next_filter.store(next);
+    for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+        shared_lock_ lock = lock_<shared_lock_>(index);
+        hash_table_[index].for_each([this, next](const T& current) {
+            next->add(hash_(current));
+        });
     }
-    rehash();
-    push(element, hash);
+    std::uint64_t sequence = bloom_->sequence.load();
+    bloom_->sequence.store(sequence + 1);
+    bloom_->spare = bloom_->filter.exchange(next);
+    bloom_->sequence.store(sequence + 2);
+    bloom_->next_filter.store(nullptr);
+    bloom_->rebuilds.fetch_add(1);
 }
 
-template <typename T, class H>
-void striped_hash_set<T, H>::rehash() {
-    std::vector<std::forward_list<T>> new_hash_table;
-    new_hash_table.resize(hash_table_size_.load() * growth_factor_);
-    for (std::forward_list<T> bucket : hash_table_) {
-        for (auto current : bucket) {
-            int hash = hash_function_(current);
-            new_hash_table[hash % new_hash_table.size()].push_front(current);
+template <typename T, class H, class Mutex>
+bloom_filter_statistics striped_hash_set<T, H, Mutex>::bloom_statistics() const {
+    bloom_filter_statistics statistics{0, 0, 0};
+    if (bloom_) {
+        for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+            statistics.rejected += bloom_->counters[index].rejected.load();
+            statistics.false_positives += bloom_->counters[index].false_positives.load();
         }
+        statistics.rebuilds = bloom_->rebuilds.load();
     }
-    hash_table_size_.store(new_hash_table.size());
-    hash_table_ = std::move(new_hash_table);
+    return statistics;
 }
 
-template <typename T, class H>
-void striped_hash_set<T, H>::remove(const T& element) {
-    int hash = hash_function_(element);
-    std::unique_lock<std::shared_timed_mutex> lock(
-            mutex_array_[hash % mutex_array_.size()]);
-    hash_table_[hash % hash_table_size_.load()].remove(element);
+template <typename T, class H, class Mutex>
+void striped_hash_set<T, H, Mutex>::enable_statistics() {
+    counters_.reset(new stripe_counters_[mutex_array_.size()]);
 }
 
-template <typename T, class H>
-bool striped_hash_set<T, H>::contains(const T& element) {
-    int hash = hash_function_(element);
-    std::unique_lock<std::shared_timed_mutex> lock(
-            mutex_array_[hash % mutex_array_.size()]);
-    for (auto current : hash_table_[hash % hash_table_size_.load()]) {
-        if (current == element) {
-            return true;
+template <typename T, class H, class Mutex>
+std::vector<stripe_statistics> striped_hash_set<T, H, Mutex>::statistics() {
+    auto hash_of = [this](const T& current) { return hash_(current); };
+    std::vector<stripe_statistics> statistics(mutex_array_.size());
+    for (std::size_t index = 0; index < mutex_array_.size(); ++index) {
+        stripe_statistics& stripe = statistics[index];
+        {
+            // taken directly to keep the snapshot out of the counters
+            shared_lock_ lock(mutex_array_[index]);
+            stripe.size = hash_table_[index].size();
+            stripe.capacity = hash_table_[index].capacity();
+            hash_table_[index].probe_lengths(hash_of, stripe.probe_lengths);
         }
+        stripe.acquisitions = counters_ ? counters_[index].acquisitions.load() : 0;
+        stripe.contended_acquisitions =
+                counters_ ? counters_[index].contended_acquisitions.load() : 0;
+        stripe.wait_ns = counters_ ? counters_[index].wait_ns.load() : 0;
+        stripe.rehashes = counters_ ? counters_[index].rehashes.load() : 0;
+        stripe.rehash_ns = counters_ ? counters_[index].rehash_ns.load() : 0;
     }
-    return false;
+    return statistics;
 }
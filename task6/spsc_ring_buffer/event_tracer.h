@@ -0,0 +1,254 @@
+#pragma once
+
+// Event tracing for the concurrency primitives of this repository. Built
+// only with -DCONCURRENCY_TRACING, otherwise the TRACE_* macros expand to
+// nothing. Every thread writes fixed-size timestamped events into its own
+// spsc_ring_buffer; a collector thread drains the rings into a Chrome
+// trace (chrome://tracing, ui.perfetto.dev):
+//
+//     event_tracer::start("trace.json");
+//     ... TRACE_SCOPE("queue::pop"); ...
+//     event_tracer::stop();
+
+#ifdef CONCURRENCY_TRACING
+
+#include "spsc_ring_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+const std::size_t TRACE_RING_CAPACITY = 1 << 14; // events per thread between drains
+const std::chrono::milliseconds TRACE_DRAIN_PERIOD(1);
+
+struct trace_event {
+    std::uint64_t ticks;
+    const char* name; // a string literal
+    char phase; // 'B'egin, 'E'nd or 'i'nstant, as in the trace format
+};
+
+class event_tracer {
+public:
+    static void start(const std::string& path);
+    static void stop(); // drains what is left and closes the file
+
+    static void emit(const char* name, char phase) {
+        if (!is_enabled_().load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (!local_ring_().ring->enqueue(trace_event{now_(), name, phase})) {
+            dropped_().fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    static std::uint64_t dropped() { return dropped_().load(); }
+
+private:
+    struct ring_ {
+        std::unique_ptr<spsc_ring_buffer<trace_event>> ring;
+        std::size_t thread;
+        std::atomic<bool> is_retired{false}; // its thread has exited
+    };
+    // hands the ring back when its thread exits: the collector drains and
+    // drops it, or it goes at once when nobody collects
+    struct ring_owner_ {
+        ring_owner_();
+        ring_owner_(const ring_owner_&) = delete;
+        ring_owner_& operator=(const ring_owner_&) = delete;
+        ~ring_owner_();
+        std::shared_ptr<ring_> ring;
+    };
+    struct registry_ {
+        ~registry_(); // finishes a trace that was never stopped
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ring_>> rings; // of the live threads and the retired undrained
+        std::size_t next_thread = 0;
+        bool is_collecting = false; // from start() to the last drain of stop()
+        std::thread collector;
+        std::atomic<bool> is_stopped{true};
+        std::ofstream file;
+        bool is_first_event = true;
+        std::uint64_t start_ticks = 0;
+        double ns_per_tick = 1;
+    };
+
+    static registry_& registry_instance_() {
+        static registry_ registry;
+        return registry;
+    }
+    static std::atomic<bool>& is_enabled_() {
+        static std::atomic<bool> is_enabled(false);
+        return is_enabled;
+    }
+    static std::atomic<std::uint64_t>& dropped_() {
+        static std::atomic<std::uint64_t> dropped(0);
+        return dropped;
+    }
+
+    // the time stamp counter where there is one, it is read in a few cycles
+    static std::uint64_t now_() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    static ring_& local_ring_() {
+        static thread_local ring_owner_ owner;
+        return *owner.ring;
+    }
+
+    static void calibrate_(registry_& registry);
+    static void drain_(registry_& registry);
+    static void stop_(registry_& registry);
+};
+
+inline event_tracer::ring_owner_::ring_owner_() : ring(std::make_shared<ring_>()) {
+    ring->ring.reset(new spsc_ring_buffer<trace_event>(TRACE_RING_CAPACITY));
+    registry_& registry = registry_instance_();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    ring->thread = registry.next_thread++;
+    registry.rings.push_back(ring);
+}
+
+inline event_tracer::ring_owner_::~ring_owner_() {
+    registry_& registry = registry_instance_();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if (registry.is_collecting) {
+        ring->is_retired.store(true, std::memory_order_release);
+        return;
+    }
+    registry.rings.erase(std::find(registry.rings.begin(), registry.rings.end(), ring));
+}
+
+inline event_tracer::registry_::~registry_() {
+    stop_(*this);
+}
+
+inline void event_tracer::calibrate_(registry_& registry) {
+    auto clock_start = std::chrono::steady_clock::now();
+    std::uint64_t ticks_start = now_();
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::uint64_t ticks = now_() - ticks_start;
+    double ns = std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - clock_start).count();
+    registry.ns_per_tick = ticks > 0 ? ns / ticks : 1;
+    registry.start_ticks = ticks_start;
+}
+
+inline void event_tracer::start(const std::string& path) {
+    registry_& registry = registry_instance_();
+    if (!registry.is_stopped.load()) {
+        throw std::logic_error("Tracing has already started.");
+    }
+    registry.file.open(path, std::ios::trunc);
+    if (!registry.file) {
+        throw std::runtime_error("Cannot write trace " + path);
+    }
+    registry.file << "[";
+    registry.is_first_event = true;
+    calibrate_(registry);
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.is_collecting = true;
+    }
+    registry.is_stopped.store(false);
+    registry.collector = std::thread([&registry] {
+        while (!registry.is_stopped.load()) {
+            drain_(registry);
+            std::this_thread::sleep_for(TRACE_DRAIN_PERIOD);
+        }
+    });
+    is_enabled_().store(true);
+}
+
+inline void event_tracer::stop() {
+    stop_(registry_instance_());
+}
+
+inline void event_tracer::stop_(registry_& registry) {
+    if (registry.is_stopped.load()) {
+        return;
+    }
+    is_enabled_().store(false);
+    registry.is_stopped.store(true);
+    registry.collector.join();
+    drain_(registry);
+    registry.file << "\n]\n";
+    registry.file.close();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.is_collecting = false;
+}
+
+inline void event_tracer::drain_(registry_& registry) {
+    std::vector<std::shared_ptr<ring_>> rings;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        rings = registry.rings;
+    }
+    trace_event event;
+    std::vector<std::shared_ptr<ring_>> retired;
+    for (const auto& ring : rings) {
+        // read first: a retired ring has had its last event written
+        if (ring->is_retired.load(std::memory_order_acquire)) {
+            retired.push_back(ring);
+        }
+        while (ring->ring->dequeue(event)) {
+            // events from before start() have no place on the time line
+            if (event.ticks < registry.start_ticks) {
+                continue;
+            }
+            double us = (event.ticks - registry.start_ticks) * registry.ns_per_tick / 1000;
+            registry.file << (registry.is_first_event ? "\n" : ",\n")
+                          << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+                          << "\",\"ts\":" << std::fixed << us << ",\"pid\":1,\"tid\":"
+                          << ring->thread << (event.phase == 'i' ? ",\"s\":\"t\"}" : "}");
+            registry.is_first_event = false;
+        }
+    }
+    if (!retired.empty()) {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (const auto& ring : retired) {
+            registry.rings.erase(std::find(registry.rings.begin(), registry.rings.end(), ring));
+        }
+    }
+}
+
+// begin and end events around the rest of the scope
+class trace_scope {
+public:
+    explicit trace_scope(const char* name) : name_(name) { event_tracer::emit(name_, 'B'); }
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+    ~trace_scope() { event_tracer::emit(name_, 'E'); }
+
+private:
+    const char* name_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_SCOPE_NAME_(line) TRACE_CONCAT_(trace_scope_, line)
+#define TRACE_SCOPE(name) trace_scope TRACE_SCOPE_NAME_(__LINE__)(name)
+#define TRACE_BEGIN(name) event_tracer::emit(name, 'B')
+#define TRACE_END(name) event_tracer::emit(name, 'E')
+#define TRACE_INSTANT(name) event_tracer::emit(name, 'i')
+
+#else
+
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#define TRACE_BEGIN(name) static_cast<void>(0)
+#define TRACE_END(name) static_cast<void>(0)
+#define TRACE_INSTANT(name) static_cast<void>(0)
+
+#endif
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <vector>
 #include <atomic>
 
@@ -18,11 +20,12 @@ private:
     std::vector<Value> buffer_;
     std::size_t capacity_;
 
-    std::atomic<std::size_t> head_;
-    std::atomic<std::size_t> tail_;
+    // on separate cache lines, the producer and the consumer each write one
+    alignas(64) std::atomic<std::size_t> head_;
+    alignas(64) std::atomic<std::size_t> tail_;
 
     std::size_t next_(std::size_t current) const noexcept {
-        return (current + 1) % capacity_;
+        return current + 1 == capacity_ ? 0 : current + 1; // no division
     }
 };
 
@@ -1,5 +1,7 @@
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include "../../task6/spsc_ring_buffer/event_tracer.h"
 
 template<class T>
 class lock_free_queue {
@@ -18,17 +20,25 @@ private:
     const static int INTERNAL_COUNT = 30;
     const static int EXTERNAL_COUNTERS = 2;
 
-    struct pointer_t_;
-    struct node_counter_;
+    struct node_t_;
+    // the counts of a node: references taken through the other counters and
+    // how many of head_, tail_ and the previous next still point to it
+    struct node_counter_ {
+        unsigned internal_count : INTERNAL_COUNT;
+        unsigned external_counters : EXTERNAL_COUNTERS;
+    };
+    // the pointer and the references taken through it change together,
+    // pointer-sized count so that no padding takes part in the CAS
+    struct pointer_t_ {
+        node_t_* ptr = nullptr;
+        std::intptr_t external_count = 0;
+    };
     struct node_t_ {
-        std::atomic<T> value;
+        std::atomic<T*> value;
         std::atomic<node_counter_> count;
         pointer_t_ next;
 
-        node_t_() noexcept {
-            next.ptr = nullptr;
-            next.external_count = 0;
-
+        node_t_() noexcept : value(nullptr) {
             node_counter_ new_count;
             new_count.internal_count = 0;
             new_count.external_counters = 2;
@@ -49,22 +59,8 @@ private:
             }
         }
     };
-    struct node_counter_ {
-        int internal_count : INTERNAL_COUNT;
-        int external_counters : EXTERNAL_COUNTERS;
-    };
-    struct pointer_t_ {
-        pointer_t_() noexcept : ptr(nullptr), external_count(0) {}
-        pointer_t_(pointer_t_&) noexcept = default;
-        pointer_t_(pointer_t_&&) noexcept = default;
-        pointer_t_& operator=(const pointer_t_&) noexcept = default;
-        pointer_t_& operator=(pointer_t_&&) noexcept = default;
-        ~pointer_t_() noexcept = default;
-        node_t_* ptr;
-        int external_count;
-    };
 
-    void increase_internal_count_(
+    void increase_external_count_(
             std::atomic<pointer_t_> &counter, pointer_t_ &old_counter);
     void free_external_counter_(pointer_t_ &old_node_ptr);
 
@@ -76,7 +72,7 @@ template<class T>
 lock_free_queue<T>::lock_free_queue() {
     pointer_t_ pointer;
     pointer.ptr = new node_t_();
-    pointer.external_count = 0;
+    pointer.external_count = 1;
     tail_.store(pointer);
     head_.store(tail_.load());
 }
@@ -90,16 +86,17 @@ void lock_free_queue<T>::enqueue(T item) {
     pointer_t_ old_tail = tail_.load();
 
     while(true) {
-        increase_internal_count_(tail_, old_tail);
+        increase_external_count_(tail_, old_tail);
         T* old_value = nullptr;
         if (old_tail.ptr->value.compare_exchange_strong(
-                old_value, new_value->get())) {
+                old_value, new_value.get())) {
             old_tail.ptr->next = new_next;
             old_tail = tail_.exchange(new_next);
             free_external_counter_(old_tail);
             new_value.release();
             break;
         }
+        TRACE_INSTANT("lock_free_queue::enqueue CAS retry");
         old_tail.ptr->release_ref();
     }
 }
@@ -108,29 +105,32 @@ template<class T>
 bool lock_free_queue<T>::dequeue(T &item) {
     pointer_t_ old_head = head_.load(std::memory_order_relaxed);
     while(true) {
-        increase_internal_count_(head_, old_head);
+        increase_external_count_(head_, old_head);
         node_t_ * const ptr = old_head.ptr;
         if (ptr == tail_.load().ptr) {
             ptr->release_ref();
             return false;
         }
         if (head_.compare_exchange_strong(old_head, ptr->next)) {
-            item = ptr->value;
+            // left set: a late enqueue must not fill a node that was taken
+            std::unique_ptr<T> value(ptr->value.load());
+            item = std::move(*value);
             free_external_counter_(old_head);
             return true;
         }
+        TRACE_INSTANT("lock_free_queue::dequeue CAS retry");
         ptr->release_ref();
     }
 }
 
 template<class T>
-void lock_free_queue<T>::increase_internal_count_(
+void lock_free_queue<T>::increase_external_count_(
         std::atomic<pointer_t_> &counter, pointer_t_ &old_counter) {
     pointer_t_ new_counter;
     do {
         new_counter = old_counter;
         ++new_counter.external_count;
-    } while(counter.compare_exchange_strong(old_counter, new_counter,
+    } while(!counter.compare_exchange_strong(old_counter, new_counter,
                                             std::memory_order_acquire,
                                             std::memory_order_relaxed));
     old_counter.external_count = new_counter.external_count;
@@ -139,7 +139,7 @@ void lock_free_queue<T>::increase_internal_count_(
 template<class T>
 void lock_free_queue<T>::free_external_counter_(pointer_t_ &old_node_ptr) {
     node_t_ * const ptr = old_node_ptr.ptr;
-    const int count_increase = old_node_ptr.external_count - 2;
+    const int count_increase = static_cast<int>(old_node_ptr.external_count - 2);
     node_counter_ old_counter = ptr->count.load(std::memory_order_relaxed);
     node_counter_ new_counter;
     do {
@@ -158,4 +158,5 @@ template<class T>
 lock_free_queue<T>::~lock_free_queue() {
     T item;
     while(dequeue(item)) {}
+    delete head_.load().ptr;
 }